@@ -9,17 +9,78 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include "sp-pipe-client.h"
 #include "sp-pipe-server.h"
+#include "sp-generator.h"
+#include "sp-ring.h"
 
 int client_to_server[2]; // Take care of the transactions from client to server
 int server_to_client[2]; // Take care of the transactions from server to client
+struct channel *channel = NULL; // Shared memory rings that replace the pipes when -r is given
 
 
-int main(){
-    if(pipe(client_to_server) == -1 || pipe(server_to_client) == -1){ // Incase either of the pipes fail
+int main(int argc, char **argv){
+    solver_threads = sysconf(_SC_NPROCESSORS_ONLN); // one worker per core unless told otherwise
+    char *listen_path = NULL; // serve games over a socket instead of forking a server
+    char *join_path = NULL; // play on a server that is already running
+    char *checkpoint_path = NULL; // file the server keeps its games in
+    bool use_rings = false; // talk through shared memory instead of pipes
+    uint64_t seed = ((uint64_t)time(NULL) << 20) ^ getpid(); // a different series of boards every run unless -s is given
+    int option;
+    while((option = getopt(argc, argv, "t:c:l:j:k:s:rx:")) != -1){
+        switch(option){
+            case 't': // number of workers for background solves
+                solver_threads = atoi(optarg);
+                break;
+            case 'c': // megabytes of memory for the solved board cache
+                cache_megabytes = atoi(optarg);
+                break;
+            case 'l': // path of the socket to host games at
+                listen_path = optarg;
+                break;
+            case 'j': // path of the socket of a running server
+                join_path = optarg;
+                break;
+            case 'k': // checkpoint file of the server
+                checkpoint_path = optarg;
+                break;
+            case 'r': // shared memory rings between the client and the server
+                use_rings = true;
+                break;
+            case 'x': // script to run instead of the menu, - for the standard input
+                script = strcmp(optarg, "-") == 0 ? stdin : fopen(optarg, "r");
+                if(script == NULL){
+                    fprintf(stderr,"Could not open the script %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 's': // seed of the boards, the same seed deals the same boards
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr,"usage: %s [-t threads] [-c cache megabytes] [-s seed] [-r] [-x script] [-l socket [-k checkpoint] | -j socket]\n", argv[0]);
+                exit(1);
+        }
+    }
+    generatorSeed(&board_generator, seed);
+    if(listen_path != NULL)
+        session_server(listen_path, checkpoint_path);
+    if(join_path != NULL)
+        join(join_path);
+    if(use_rings){
+        channel = channelCreate();
+        if(channel == NULL){
+            fprintf(stderr,"Oops.. An error occurred. Please try again later.\n");
+            exit(1);
+        }
+        channel->to_server.reader = channel->to_client.writer = getpid(); // the parent is the server
+    }else if(pipe(client_to_server) == -1 || pipe(server_to_client) == -1){ // Incase either of the pipes fail
         fprintf(stderr,"Oops.. An error occurred. Please try again later.\n");
         exit(1);
     }
@@ -31,6 +92,12 @@ int main(){
     if(child == 0){ // Child process aka the client
         client();
     }else{
+        if(channel != NULL)
+            channel->to_server.writer = channel->to_client.reader = child;
+        if(script != NULL){ // the server's messages would mix with the results of the script
+            int null = open("/dev/null", O_WRONLY);
+            dup2(null, STDOUT_FILENO);
+        }
         server();
     }
 }
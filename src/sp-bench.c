@@ -0,0 +1,328 @@
+/**
+ * A @code sp-bench times the game engine on every board size and the round trip of a
+ * request to a forked server over the pipe protocol. Every result is one CSV line so runs
+ * of different releases can be compared.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sp-pipe-server.h"
+#include "sp-generator.h"
+#include "sp-message.h"
+#include "sp-ring.h"
+#include "sp-packed.h"
+
+#define ENGINE_OPS 2000000L // calls timed for each engine function
+#define FILE_OPS 2000L // saves and loads timed, they touch the disk, fewer on boards over 10x10
+#define ROUND_TRIPS 100000L // requests timed for each command
+#define BATCH_MOVES 64 // moves sent in each batch request
+#define PACKED_BOARDS 4096 // packed boards measured in each pass
+#define BENCH_FILE "sp-bench.sav" // scratch file for save and load
+
+int client_to_server[2]; // Take care of the transactions from client to server
+int server_to_client[2]; // Take care of the transactions from server to client
+struct channel *channel = NULL; // Shared memory rings used instead of the pipes, NULL for pipes
+
+volatile long sink; // keeps results alive so the calls aren't optimized out
+
+/**
+ * Reads the monotonic clock
+ * @return the time in nanoseconds
+ */
+static long long now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/**
+ * Prints one result line
+ * @param name what was timed
+ * @param size the size of the square matrix (gameboard), 0 if it doesn't apply
+ * @param ops the number of operations timed
+ * @param elapsed the nanoseconds they took
+ * @param p50 the median latency in nanoseconds, -1 if it wasn't measured
+ * @param p99 the 99th percentile latency in nanoseconds, -1 if it wasn't measured
+ */
+static void report(const char *name, int size, long ops, long long elapsed, long long p50, long long p99){
+    printf("%s,%d,%ld,%.2f,%.0f,%lld,%lld\n", name, size, ops, (double)elapsed / ops, ops * 1e9 / elapsed, p50, p99);
+    fflush(stdout);
+}
+
+/**
+ * Compares two latencies for sorting
+ */
+static int compareLatency(const void *a, const void *b){
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Times the manhattan distance of packed boards one at a time and a batch at a time, with a plain
+ * loop over the cells of the same boards for comparison
+ * @param size the size of the square matrix (gameboard), at most PACKED_MAX_SIZE
+ */
+static void benchPacked(int size){
+    static packed_state states[PACKED_BOARDS];
+    static unsigned char distances[PACKED_BOARDS];
+    unsigned char cells[PACKED_MAX_SIZE*PACKED_MAX_SIZE];
+    for(int i = 0; i<PACKED_BOARDS;i++){
+        generateUniform(&board_generator, cells, size);
+        states[i] = packCells(cells, size);
+    }
+    long passes = ENGINE_OPS / PACKED_BOARDS;
+    long ops = passes * PACKED_BOARDS;
+    long total = 0;
+
+    long long start = now();
+    for(long p = 0; p<passes;p++){
+        for(int i = 0; i<PACKED_BOARDS;i++){
+            int distance = 0;
+            for(int cell = 0; cell<size*size;cell++){
+                int tile = packedTile(states[i], cell);
+                if(tile != 0) distance += abs(cell/size - (tile-1)/size) + abs(cell%size - (tile-1)%size);
+            }
+            total += distance;
+        }
+    }
+    report("manhattan_loop", size, ops, now() - start, -1, -1);
+
+    start = now();
+    for(long p = 0; p<passes;p++){
+        for(int i = 0; i<PACKED_BOARDS;i++){
+            total += packedManhattan(states[i], size);
+        }
+    }
+    report("packedManhattan", size, ops, now() - start, -1, -1);
+
+    start = now();
+    for(long p = 0; p<passes;p++){
+        packedManhattanBatch(states, PACKED_BOARDS, size, distances);
+        total += distances[p % PACKED_BOARDS];
+    }
+    report("packedManhattanBatch", size, ops, now() - start, -1, -1);
+    sink = total;
+}
+
+/**
+ * Times the engine functions on one board size
+ * @param size the size of the square matrix (gameboard)
+ */
+static void benchEngine(int size){
+    struct game *game = allocate_game(size);
+    if(game == NULL) return;
+    shuffle_tiles(game);
+    int tiles = size*size - 1;
+    long file_ops = size <= 10 ? FILE_OPS : FILE_OPS * 100 / (size*size) + 10; // about the same bytes as a 10x10 board
+    long total = 0;
+
+    int neighbour = cell_tile(game, game->blank_position < size*size-1 && (game->blank_position+1) % size != 0 ? game->blank_position+1 : game->blank_position-1); // moving it twice puts it back
+    long long start = now();
+    for(long i = 0; i<ENGINE_OPS;i++){
+        moveTile(game, neighbour);
+    }
+    report("moveTile", size, ENGINE_OPS, now() - start, -1, -1);
+
+    start = now();
+    for(long i = 0; i<ENGINE_OPS;i++){
+        total += isMoveValid(game, 1 + i % tiles);
+    }
+    report("isMoveValid", size, ENGINE_OPS, now() - start, -1, -1);
+
+    start = now();
+    for(long i = 0; i<ENGINE_OPS;i++){
+        total += checkForWin(game);
+    }
+    report("checkForWin", size, ENGINE_OPS, now() - start, -1, -1);
+
+    start = now();
+    for(long i = 0; i<ENGINE_OPS;i++){
+        total += getTileLocation(game, 1 + i % tiles);
+    }
+    report("getTileLocation", size, ENGINE_OPS, now() - start, -1, -1);
+
+    start = now();
+    for(long i = 0; i<file_ops;i++){
+        total += save(game, BENCH_FILE);
+    }
+    report("save", size, file_ops, now() - start, -1, -1);
+
+    start = now();
+    for(long i = 0; i<file_ops;i++){
+        total += load(&game, BENCH_FILE);
+    }
+    report("load", size, file_ops, now() - start, -1, -1);
+
+    unlink(BENCH_FILE);
+    deallocate(game);
+    sink = total;
+}
+
+/**
+ * Sends a request to the server over the transport in use and waits for its reply
+ * @param request the request
+ * @param reply filled with the reply
+ */
+static void exchange(struct message *request, struct message *reply){
+    bool answered = channel != NULL
+        ? ringSendFrame(&channel->to_server, request) && ringReceiveFrame(&channel->to_client, reply)
+        : sendFrame(client_to_server[1], request) && receiveFrame(server_to_client[0], reply);
+    if(!answered){
+        fprintf(stderr, "Lost the connection to the server\n");
+        exit(1);
+    }
+}
+
+/**
+ * Times one command sent to the server again and again
+ * @param transport name of the transport in use
+ * @param name what is timed
+ * @param command the type of request
+ * @param argument an int sent after the command, or -1 for none
+ * @param latencies room for ROUND_TRIPS latencies
+ */
+static void benchRoundTrip(const char *transport, const char *name, int command, int argument, long long *latencies){
+    struct message request = {0};
+    struct message reply = {0};
+    unsigned int session = 0;
+    long long start = now();
+    for(long i = 0; i<ROUND_TRIPS;i++){
+        long long sent = now();
+        messageReset(&request);
+        messageWrite(&request, &session, sizeof(session));
+        messageWrite(&request, &command, sizeof(command));
+        if(argument >= 0) messageWrite(&request, &argument, sizeof(argument));
+        exchange(&request, &reply);
+        latencies[i] = now() - sent;
+    }
+    long long elapsed = now() - start;
+    qsort(latencies, ROUND_TRIPS, sizeof(long long), compareLatency);
+    char label[64];
+    snprintf(label, sizeof(label), "%s_%s", transport, name);
+    report(label, 0, ROUND_TRIPS, elapsed, latencies[ROUND_TRIPS/2], latencies[ROUND_TRIPS*99/100]);
+    messageFree(&request);
+    messageFree(&reply);
+}
+
+/**
+ * Times moves sent BATCH_MOVES at a time, each tile is moved twice so the board comes back
+ * @param transport name of the transport in use
+ * @param latencies room for ROUND_TRIPS latencies
+ */
+static void benchBatch(const char *transport, long long *latencies){
+    struct message request = {0};
+    struct message reply = {0};
+    unsigned int session = 0;
+    int command = 5;
+    messageReset(&request); // finds a tile next to the empty slot
+    messageWrite(&request, &session, sizeof(session));
+    messageWrite(&request, &command, sizeof(command));
+    exchange(&request, &reply);
+    int size;
+    messageRead(&reply, &size, sizeof(size));
+    int *board = malloc(sizeof(int) * size * size);
+    if(board == NULL) exit(1);
+    messageRead(&reply, board, sizeof(int) * size * size);
+    int blank = 0;
+    while(board[blank] != 0) blank++;
+    int tile = board[blank%size < size-1 ? blank+1 : blank-1];
+    free(board);
+
+    command = 13;
+    int count = BATCH_MOVES;
+    bool want_blank = false;
+    messageReset(&request);
+    messageWrite(&request, &session, sizeof(session));
+    messageWrite(&request, &command, sizeof(command));
+    messageWrite(&request, &count, sizeof(count));
+    messageWrite(&request, &want_blank, sizeof(want_blank));
+    for(int i = 0; i<count;i++){
+        messageWrite(&request, &tile, sizeof(tile));
+    }
+    long long start = now();
+    for(long i = 0; i<ROUND_TRIPS;i++){
+        long long sent = now();
+        exchange(&request, &reply);
+        latencies[i] = now() - sent;
+    }
+    long long elapsed = now() - start;
+    qsort(latencies, ROUND_TRIPS, sizeof(long long), compareLatency);
+    char label[64];
+    snprintf(label, sizeof(label), "%s_batch_move", transport);
+    report(label, 0, ROUND_TRIPS * BATCH_MOVES, elapsed, latencies[ROUND_TRIPS/2], latencies[ROUND_TRIPS*99/100]); // per move, latencies per batch
+    messageFree(&request);
+    messageFree(&reply);
+}
+
+/**
+ * Forks a server like the game does and times requests to it
+ * @param rings whether to talk through shared memory rings instead of pipes
+ */
+static void benchTransport(bool rings){
+    const char *transport = rings ? "ring" : "pipe";
+    if(rings){
+        channel = channelCreate();
+        if(channel == NULL){
+            fprintf(stderr, "Could not map the rings\n");
+            exit(1);
+        }
+        channel->to_server.writer = channel->to_client.reader = getpid(); // here the parent is the client
+    }else if(pipe(client_to_server) == -1 || pipe(server_to_client) == -1){
+        fprintf(stderr, "Could not create the pipes\n");
+        exit(1);
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    if(child < 0){
+        fprintf(stderr, "Could not fork the server\n");
+        exit(1);
+    }
+    if(child == 0){
+        int null = open("/dev/null", O_WRONLY); // the server's messages would mix with the results
+        dup2(null, STDOUT_FILENO);
+        server();
+    }
+    if(rings){
+        channel->to_server.reader = channel->to_client.writer = child;
+    }else{
+        close(client_to_server[0]);
+        close(server_to_client[1]);
+    }
+    long long *latencies = malloc(sizeof(long long) * ROUND_TRIPS);
+    if(latencies == NULL) exit(1);
+    benchRoundTrip(transport, "won", 4, -1, latencies); // smallest request and reply
+    benchRoundTrip(transport, "move", 1, 1, latencies);
+    benchRoundTrip(transport, "retrieve", 5, -1, latencies); // largest regular reply
+    benchBatch(transport, latencies);
+    free(latencies);
+    if(rings)
+        ringClose(&channel->to_server); // the server exits once the ring closes
+    else
+        close(client_to_server[1]); // the server exits once the pipe closes
+    waitpid(child, NULL, 0);
+    channel = NULL;
+}
+
+int main(int argc, char **argv){
+    generatorSeed(&board_generator, 1); // the same boards every run
+    printf("benchmark,size,ops,ns_per_op,ops_per_sec,p50_ns,p99_ns\n");
+    for(int size = 2; size<=10;size++){
+        benchEngine(size);
+    }
+    for(int size = 2; size<=PACKED_MAX_SIZE;size++){
+        benchPacked(size);
+    }
+    benchEngine(100); // two bytes a cell
+    benchEngine(MAX_SIZE); // four bytes a cell
+    benchTransport(false);
+    benchTransport(true);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * A @code sp-cache remembers how far solved boards are from winning and which tile to
+ * move next, so repeated solves and hints skip the search. It is a fixed size hash table
+ * shared by every thread without locks: each entry stores its key xored with its data, so
+ * a reader that catches a half written entry sees a key that doesn't match and treats it
+ * as a miss.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "sp-cache.h"
+#include "sp-packed.h"
+
+#define DISTANCE_BITS 0xFFFFull // moves left to win
+#define TILE_SHIFT 16 // next tile to move
+#define TILE_BITS 0xFFFFull
+#define OPTIMAL_BIT (1ull << 32) // the distance is the shortest possible
+#define GENERATION_SHIFT 40 // solve during which the entry was written
+#define VALID_BIT (1ull << 63) // keeps a used entry from ever being all zeros
+
+/**
+ * One slot of the table
+ */
+struct cache_entry {
+    _Atomic uint64_t check; // the key xored with data
+    _Atomic uint64_t data; // the packed distance, tile, flag and generation
+};
+
+static struct cache_entry *table = NULL; // NULL until cacheInit, every call is then a no-op
+static size_t bucket_mask; // number of buckets minus one
+static atomic_uint generation; // bumped by every new search, older entries are replaced first
+static atomic_ulong hits, misses, stores, replacements;
+
+/**
+ * Sets up the cache, the table is the largest power of two of buckets that fits the budget
+ * @param bytes the memory the cache may use
+ * @return true if the table was allocated
+ */
+bool cacheInit(size_t bytes){
+    size_t buckets = 1;
+    while(buckets*2 * CACHE_WAYS * sizeof(struct cache_entry) <= bytes) buckets *= 2;
+    struct cache_entry *entries = aligned_alloc(64, buckets * CACHE_WAYS * sizeof(struct cache_entry)); // calloc would only align to 16 bytes, so a bucket could straddle two lines
+    if(entries == NULL) return false;
+    memset(entries, 0, buckets * CACHE_WAYS * sizeof(struct cache_entry));
+    free(table);
+    table = entries;
+    bucket_mask = buckets-1;
+    return true;
+}
+
+/**
+ * Hashes a board into a cache key. Boards up to 4x4 use their packed state, which is
+ * exact, larger boards xor a mixed value of every tile and cell
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @return the key of the board
+ */
+uint64_t cacheKey(const int *board, int size){
+    if(size <= PACKED_MAX_SIZE) return packState(board, size);
+    uint64_t key = packedHash(size);
+    for(int i = 0; i<size*size;i++){
+        key ^= packedHash(((uint64_t)size << 40) | ((uint64_t)board[i] << 20) | i);
+    }
+    return key;
+}
+
+/**
+ * Finds a board in the cache
+ * @param key the key of the board
+ * @param distance filled with the number of moves left to win
+ * @param next_tile filled with the tile to move next, 0 if the board is won
+ * @param optimal filled with whether the distance is the shortest possible
+ * @return true if the board was found
+ */
+bool cacheLookup(uint64_t key, int *distance, int *next_tile, bool *optimal){
+    if(table == NULL) return false;
+    struct cache_entry *bucket = &table[(packedHash(key) & bucket_mask) * CACHE_WAYS];
+    for(int way = 0; way<CACHE_WAYS;way++){
+        uint64_t data = atomic_load_explicit(&bucket[way].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&bucket[way].check, memory_order_relaxed);
+        if((data & VALID_BIT) && (check ^ data) == key){
+            *distance = data & DISTANCE_BITS;
+            *next_tile = (data >> TILE_SHIFT) & TILE_BITS;
+            *optimal = (data & OPTIMAL_BIT) != 0;
+            atomic_fetch_add_explicit(&hits, 1, memory_order_relaxed);
+            return true;
+        }
+    }
+    atomic_fetch_add_explicit(&misses, 1, memory_order_relaxed);
+    return false;
+}
+
+/**
+ * Stores a board in the cache. The board replaces its own entry, an empty one, or else
+ * the entry that is cheapest to lose, the one closest to winning once its age is counted
+ * @param key the key of the board
+ * @param distance the number of moves left to win
+ * @param next_tile the tile to move next, 0 if the board is won
+ * @param optimal whether the distance is the shortest possible
+ */
+void cacheStore(uint64_t key, int distance, int next_tile, bool optimal){
+    if(table == NULL) return;
+    unsigned int now = atomic_load_explicit(&generation, memory_order_relaxed) & 0xFF;
+    uint64_t data = VALID_BIT | ((uint64_t)now << GENERATION_SHIFT) | (optimal ? OPTIMAL_BIT : 0)
+        | (((uint64_t)next_tile & TILE_BITS) << TILE_SHIFT) | ((uint64_t)distance & DISTANCE_BITS);
+    struct cache_entry *bucket = &table[(packedHash(key) & bucket_mask) * CACHE_WAYS];
+    int victim = -1;
+    int cheapest = 0;
+    long lowest = __LONG_MAX__;
+    for(int way = 0; way<CACHE_WAYS && victim == -1;way++){
+        uint64_t old = atomic_load_explicit(&bucket[way].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&bucket[way].check, memory_order_relaxed);
+        if(!(old & VALID_BIT)){ // empty slot
+            victim = way;
+        }else if((check ^ old) == key){ // the board itself, keep an optimal distance over a weighted one
+            if((old & OPTIMAL_BIT) && !optimal) return;
+            victim = way;
+        }else{
+            long age = (now - ((old >> GENERATION_SHIFT) & 0xFF)) & 0xFF;
+            long score = (long)(old & DISTANCE_BITS) - 16*age; // far boards save the most search, old ones the least
+            if(score < lowest){
+                lowest = score;
+                cheapest = way;
+            }
+        }
+    }
+    if(victim == -1){ // the bucket is full of other boards
+        victim = cheapest;
+        atomic_fetch_add_explicit(&replacements, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&bucket[victim].data, data, memory_order_relaxed);
+    atomic_store_explicit(&bucket[victim].check, key ^ data, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stores, 1, memory_order_relaxed);
+}
+
+/**
+ * Starts a new generation, entries from older ones are replaced first
+ */
+void cacheNewGeneration(){
+    atomic_fetch_add_explicit(&generation, 1, memory_order_relaxed);
+}
+
+/**
+ * Reads the counters of the cache
+ * @param stats filled with the counters
+ */
+void cacheGetStats(struct cache_stats *stats){
+    stats->hits = atomic_load(&hits);
+    stats->misses = atomic_load(&misses);
+    stats->stores = atomic_load(&stores);
+    stats->replacements = atomic_load(&replacements);
+    stats->entries = table == NULL ? 0 : (bucket_mask+1) * CACHE_WAYS;
+}
@@ -0,0 +1,29 @@
+#ifndef SP_CACHE
+#define SP_CACHE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_DEFAULT_MB 16 // memory given to the cache unless the -c flag says otherwise
+#define CACHE_WAYS 4 // entries per bucket, a bucket fills one cache line
+
+/**
+ * Counters of the cache since it was set up
+ */
+struct cache_stats {
+    unsigned long hits; // lookups that found the board
+    unsigned long misses; // lookups that didn't
+    unsigned long stores; // entries written
+    unsigned long replacements; // stores that pushed out another board
+    size_t entries; // capacity of the cache
+};
+
+bool cacheInit(size_t bytes);
+uint64_t cacheKey(const int *board, int size);
+bool cacheLookup(uint64_t key, int *distance, int *next_tile, bool *optimal);
+void cacheStore(uint64_t key, int distance, int next_tile, bool optimal);
+void cacheNewGeneration();
+void cacheGetStats(struct cache_stats *stats);
+
+#endif
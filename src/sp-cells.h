@@ -0,0 +1,44 @@
+#ifndef SP_CELLS
+#define SP_CELLS
+
+#include <stdint.h>
+
+#define CELLS_MAX_SIZE 1000 // largest board whose cells can be stored
+
+/**
+ * Finds the bytes each cell of a board takes, the fewest that hold every tile and every cell index
+ * with one value to spare, so a 15x15 board still takes a byte a cell and a 1000x1000 one four
+ * @param size the size of the square matrix (gameboard)
+ * @return 1, 2 or 4
+ */
+static inline int cellWidth(int size){
+    return size*size <= 0xFF ? 1 : size*size <= 0xFFFF ? 2 : 4;
+}
+
+/**
+ * Reads one cell of a board
+ * @param cells the cells, row after row
+ * @param width the bytes per cell
+ * @param i the index of the cell
+ * @return the value of the cell
+ */
+static inline uint32_t cellGet(const unsigned char *cells, int width, uint32_t i){
+    if(width == 1) return cells[i];
+    if(width == 2) return ((const uint16_t *)cells)[i];
+    return ((const uint32_t *)cells)[i];
+}
+
+/**
+ * Writes one cell of a board
+ * @param cells the cells, row after row
+ * @param width the bytes per cell
+ * @param i the index of the cell
+ * @param value the value of the cell
+ */
+static inline void cellSet(unsigned char *cells, int width, uint32_t i, uint32_t value){
+    if(width == 1) cells[i] = value;
+    else if(width == 2) ((uint16_t *)cells)[i] = value;
+    else ((uint32_t *)cells)[i] = value;
+}
+
+#endif
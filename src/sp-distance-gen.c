@@ -0,0 +1,147 @@
+/**
+ * A @code sp-distance-gen builds the distance table file of a small board size. It searches
+ * breadth first from the winning board over every solvable board, so each entry is the
+ * fewest moves that win its board.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sp-distance.h"
+
+#define UNSEEN 0xFF // table entry not reached yet
+
+/**
+ * Unpacks a board kept four bits a cell in the queue
+ * @param state the packed board, cell 0 in the lowest bits
+ * @param board filled with the tiles of the board, row after row
+ * @param cells the number of cells on the board
+ */
+static void unpack(uint64_t state, int *board, int cells){
+    for(int i = 0; i<cells;i++){
+        board[i] = (state >> 4*i) & 0xF;
+    }
+}
+
+/**
+ * Packs a board four bits a cell for the queue
+ * @param board the tiles of the board, row after row
+ * @param cells the number of cells on the board
+ * @return the packed board, cell 0 in the lowest bits
+ */
+static uint64_t pack(const int *board, int cells){
+    uint64_t state = 0;
+    for(int i = 0; i<cells;i++){
+        state |= (uint64_t)board[i] << 4*i;
+    }
+    return state;
+}
+
+/**
+ * Fills the distance of every solvable board by searching breadth first from the winning
+ * board. The queue holds each board once, in the order it was reached
+ * @param distance filled with the fewest moves that win each board, by rank
+ * @param size the size of the square matrix (gameboard)
+ * @return the largest distance, or -1 if out of memory
+ */
+static int buildTable(unsigned char *distance, int size){
+    int cells = size*size;
+    unsigned long entries = distanceEntries(size);
+    uint64_t *queue = malloc(entries * sizeof(uint64_t));
+    if(queue == NULL) return -1;
+    memset(distance, UNSEEN, entries);
+    int board[DISTANCE_MAX_SIZE*DISTANCE_MAX_SIZE];
+    for(int i = 0; i<cells;i++){
+        board[i] = (i+1) % cells; // the winning board, the empty slot last
+    }
+    distance[distanceRank(board, size)] = 0;
+    queue[0] = pack(board, cells);
+    unsigned long head = 0, tail = 1;
+    int deepest = 0;
+    static const int rows[4] = {-1, 1, 0, 0}, columns[4] = {0, 0, -1, 1};
+    while(head < tail){
+        unpack(queue[head++], board, cells);
+        int blank = 0;
+        while(board[blank] != 0) blank++;
+        int moves = distance[distanceRank(board, size)] + 1;
+        for(int d = 0; d<4;d++){
+            int row = blank/size + rows[d], column = blank%size + columns[d];
+            if(row < 0 || row >= size || column < 0 || column >= size) continue;
+            int cell = row*size + column;
+            board[blank] = board[cell];
+            board[cell] = 0;
+            unsigned long rank = distanceRank(board, size);
+            if(distance[rank] == UNSEEN){
+                distance[rank] = moves;
+                queue[tail++] = pack(board, cells);
+                if(moves > deepest) deepest = moves;
+            }
+            board[cell] = board[blank];
+            board[blank] = 0;
+        }
+    }
+    free(queue);
+    return deepest;
+}
+
+int main(int argc, char **argv){
+    if(argc != 3){
+        fprintf(stderr, "usage: %s size output\n", argv[0]);
+        return 1;
+    }
+    int size = atoi(argv[1]);
+    if(size < 2 || size > DISTANCE_MAX_SIZE){
+        fprintf(stderr, "No distance table for a %dx%d board\n", size, size);
+        return 1;
+    }
+    unsigned long entries = distanceEntries(size);
+    unsigned char *distance = malloc(entries);
+    int deepest = distance != NULL ? buildTable(distance, size) : -1;
+    if(deepest < 0){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    struct distance_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISTANCE_MAGIC, 4);
+    header.version = DISTANCE_VERSION;
+    header.size = size;
+    header.bits = deepest < 16 ? 4 : 5;
+    header.entries = entries;
+    unsigned long length = (entries*header.bits + 7)/8 + 1; // one byte spare for the two byte reads
+    unsigned char *packed = calloc(length, 1);
+    if(packed == NULL){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for(unsigned long i = 0; i<entries;i++){
+        if(distance[i] == UNSEEN){ // every rank belongs to a solvable board, so all are reached
+            fprintf(stderr, "Board %lu was never reached\n", i);
+            return 1;
+        }
+        unsigned long bit = i*header.bits;
+        unsigned int value = (unsigned int)distance[i] << bit%8;
+        packed[bit/8] |= value & 0xFF;
+        packed[bit/8 + 1] |= value >> 8;
+    }
+    fprintf(stderr, "%dx%d: %lu boards, at most %d moves, %u bits each\n", size, size, entries, deepest, header.bits);
+    FILE *fp = fopen(argv[2], "wb");
+    if(fp == NULL){
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        return 1;
+    }
+    if(fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(packed, 1, length, fp) != length){
+        fprintf(stderr, "Could not write %s\n", argv[2]);
+        fclose(fp);
+        remove(argv[2]);
+        return 1;
+    }
+    fclose(fp);
+    free(packed);
+    free(distance);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * A @code sp-distance holds the complete distance tables of the smallest boards. Every
+ * solvable board has an entry giving the fewest moves that win it, so the solver answers
+ * with a lookup per move instead of a search. The tables are built offline by
+ * sp-distance-gen and mapped read only, like the pattern databases.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sp-distance.h"
+#include "sp-pdb.h"
+
+#define DISTANCE_MAX_CELLS (DISTANCE_MAX_SIZE*DISTANCE_MAX_SIZE)
+
+static struct distance_table tables[DISTANCE_MAX_SIZE+1]; // tables[size] once mapped
+static atomic_bool attempted[DISTANCE_MAX_SIZE+1]; // whether the file for a size was already looked for, read without the lock
+static pthread_mutex_t loading = PTHREAD_MUTEX_INITIALIZER; // solvers on several threads may ask at once
+
+/**
+ * Counts the solvable boards of a size
+ * @param size the size of the square matrix (gameboard)
+ * @return cells!/2, the number of entries in the size's table
+ */
+unsigned long distanceEntries(int size){
+    return pdbEntries(size*size-2, size*size);
+}
+
+/**
+ * Turns a solvable board into a dense index of its table. The cells of the empty slot and of
+ * every tile but the last two form the Lehmer code of the board. Those two tiles fill the two
+ * cells left, and only one of the two ways is solvable, so leaving them out halves the table
+ * with no two solvable boards sharing an index
+ * @param board the tiles of the board, row after row, solvable
+ * @param size the size of the square matrix (gameboard)
+ * @return a number below distanceEntries(size)
+ */
+unsigned long distanceRank(const int *board, int size){
+    int cells = size*size;
+    int positions[DISTANCE_MAX_CELLS];
+    for(int i = 0; i<cells;i++){
+        positions[board[i]] = i;
+    }
+    return pdbRank(positions, cells-2, cells);
+}
+
+/**
+ * Maps the distance table file of a board size, called once per size with loading held
+ * @param size the size of the square matrix (gameboard)
+ * @return the table, or NULL if there is no valid file for the size
+ */
+static const struct distance_table *mapTable(int size){
+    struct distance_table *table = &tables[size];
+    const char *directory = getenv("SP_PDB_DIR"); // sp-distance-gen writes next to the pattern databases
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s/dist-%dx%d.bin", directory != NULL ? directory : ".", size, size);
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) return NULL;
+    struct stat info;
+    if(fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(struct distance_header)){
+        close(fd);
+        return NULL;
+    }
+    int flags = MAP_SHARED; // shared so other processes reuse the pages
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // read in now, so no lookup waits on the disk
+#endif
+    void *map = mmap(NULL, info.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return NULL;
+    const struct distance_header *header = map;
+    unsigned long entries = distanceEntries(size);
+    bool valid = memcmp(header->magic, DISTANCE_MAGIC, 4) == 0 && header->version == DISTANCE_VERSION
+        && header->size == (unsigned int)size && (header->bits == 4 || header->bits == 5)
+        && header->entries == entries
+        && sizeof(struct distance_header) + (entries*header->bits + 7)/8 + 1 <= (unsigned long long)info.st_size; // one byte spare for the two byte reads
+    if(!valid){
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    table->size = size;
+    table->bits = header->bits;
+    table->entries = entries;
+    table->packed = (const unsigned char *)map + sizeof(struct distance_header);
+    table->map = map;
+    table->map_length = info.st_size;
+    return table;
+}
+
+/**
+ * Maps the distance table of every size that has one, so the first small board is answered at once
+ * @return the number of tables mapped
+ */
+int distanceInit(void){
+    int mapped = 0;
+    for(int size = 2; size<=DISTANCE_MAX_SIZE;size++){
+        if(distanceLoad(size) != NULL) mapped++;
+    }
+    return mapped;
+}
+
+/**
+ * Maps the distance table of a board size the first time it is asked for
+ * @param size the size of the square matrix (gameboard)
+ * @return the table, or NULL if there is no valid file for the size
+ */
+const struct distance_table *distanceLoad(int size){
+    if(size < 2 || size > DISTANCE_MAX_SIZE) return NULL;
+    if(!atomic_load_explicit(&attempted[size], memory_order_acquire)){ // once looked for the answer never changes, so solvers skip the lock
+        pthread_mutex_lock(&loading);
+        if(!atomic_load_explicit(&attempted[size], memory_order_relaxed)){
+            mapTable(size);
+            atomic_store_explicit(&attempted[size], true, memory_order_release);
+        }
+        pthread_mutex_unlock(&loading);
+    }
+    return tables[size].map != NULL ? &tables[size] : NULL;
+}
+
+/**
+ * Looks up the fewest moves that win a board
+ * @param table the distance table of the board size
+ * @param board the tiles of the board, row after row, solvable
+ * @return the number of moves
+ */
+int distanceLookup(const struct distance_table *table, const int *board){
+    unsigned long bit = distanceRank(board, table->size) * table->bits;
+    const unsigned char *bytes = table->packed + bit/8;
+    unsigned int pair = bytes[0] | bytes[1] << 8; // an entry spans two bytes at most
+    return (pair >> bit%8) & ((1u << table->bits) - 1);
+}
@@ -0,0 +1,39 @@
+#ifndef SP_DISTANCE
+#define SP_DISTANCE
+
+#include <stddef.h>
+
+#define DISTANCE_MAGIC "SPDT" // first bytes of every distance table file
+#define DISTANCE_VERSION 1
+#define DISTANCE_MAX_SIZE 3 // a 4x4 board has far too many states to list
+
+/**
+ * Layout of the start of a distance table file, the packed entries follow right after it
+ */
+struct distance_header {
+    char magic[4]; // DISTANCE_MAGIC
+    unsigned int version; // DISTANCE_VERSION
+    unsigned int size; // the size of the square matrix (gameboard) the table was built for
+    unsigned int bits; // bits of each entry, 4 or 5
+    unsigned long long entries; // number of entries, one for every solvable board
+};
+
+/**
+ * A distance table mapped into memory
+ */
+struct distance_table {
+    int size; // the size of the square matrix (gameboard)
+    int bits; // bits of each entry
+    unsigned long entries; // number of entries
+    const unsigned char *packed; // the entries, bits apiece, lowest bits first
+    void *map; // the whole mapped file
+    size_t map_length; // length of the mapping
+};
+
+unsigned long distanceEntries(int size);
+unsigned long distanceRank(const int *board, int size);
+int distanceInit(void);
+const struct distance_table *distanceLoad(int size);
+int distanceLookup(const struct distance_table *table, const int *board);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * A @code sp-gen writes a corpus of boards to a save file for benchmarks, either uniform
+ * random solvable boards or boards a fixed number of random moves away from winning.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include "sp-generator.h"
+
+int main(int argc, char **argv){
+    uint64_t seed = 1;
+    int moves = 0; // uniform boards unless -w is given
+    int option;
+    while((option = getopt(argc, argv, "s:w:")) != -1){
+        switch(option){
+            case 's': // seed, the same seed writes the same file
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'w': // length of the random walk of each board
+                moves = atoi(optarg);
+                break;
+            default:
+                optind = argc; // falls through to the usage below
+                break;
+        }
+    }
+    if(argc - optind != 3){
+        fprintf(stderr, "usage: %s [-s seed] [-w moves] size count output\n", argv[0]);
+        return 1;
+    }
+    int size = atoi(argv[optind]);
+    unsigned long count = strtoul(argv[optind+1], NULL, 0);
+    if(!generateFile(argv[optind+2], size, count, moves, seed)){
+        fprintf(stderr, "Could not write %lu boards of size %d to %s\n", count, size, argv[optind+2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * A @code sp-generator makes new boards. Boards are either drawn uniformly from every
+ * solvable board or reached by a random walk of legal moves from the won board, which
+ * grades them by difficulty. A whole corpus of boards can be written to a save file.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "sp-generator.h"
+#include "sp-save.h"
+#include "sp-cells.h"
+
+#define GENERATE_CHUNK (4u << 20) // bytes of records built before each write
+
+/**
+ * Rotates bits to the left
+ * @param x the bits
+ * @param k how far to rotate
+ * @return the rotated bits
+ */
+static inline uint64_t rotate(uint64_t x, int k){
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Seeds a generator, the state is spread out with splitmix64 so close seeds give unrelated streams
+ * @param g the generator
+ * @param seed the seed
+ */
+void generatorSeed(struct generator *g, uint64_t seed){
+    for(int i = 0; i<4;i++){
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        g->state[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * Draws 64 random bits
+ * @param g the generator
+ * @return the bits
+ */
+uint64_t generatorNext(struct generator *g){
+    uint64_t *s = g->state;
+    uint64_t result = rotate(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate(s[3], 45);
+    return result;
+}
+
+/**
+ * Draws a number below a bound without modulo bias, by Lemire's multiply and reject
+ * @param g the generator
+ * @param bound how many numbers to pick from
+ * @return a number from 0 to bound-1
+ */
+uint32_t generatorBelow(struct generator *g, uint32_t bound){
+    uint64_t product = (generatorNext(g) >> 32) * bound;
+    if((uint32_t)product < bound){
+        uint32_t threshold = -bound % bound;
+        while((uint32_t)product < threshold){
+            product = (generatorNext(g) >> 32) * bound;
+        }
+    }
+    return product >> 32;
+}
+
+/**
+ * Draws a board uniformly from every solvable board of a size. The tiles are shuffled from
+ * the won board while counting swaps, and if the parity comes out wrong two tiles are swapped
+ * @param g the generator
+ * @param cells filled with the tiles of the board, row after row, cellWidth(size) bytes each
+ * @param size the size of the square matrix (gameboard)
+ */
+void generateUniform(struct generator *g, unsigned char *cells, int size){
+    int count = size*size;
+    int width = cellWidth(size);
+    for(int i = 0; i<count-1;i++){
+        cellSet(cells, width, i, i+1); // tile t belongs in cell t-1
+    }
+    cellSet(cells, width, count-1, 0);
+    int parity = 0; // of the permutation from the won board
+    for(int i = count-1; i>0;i--){ // Fisher-Yates
+        int j = generatorBelow(g, i+1);
+        if(j != i){
+            uint32_t tile = cellGet(cells, width, i);
+            cellSet(cells, width, i, cellGet(cells, width, j));
+            cellSet(cells, width, j, tile);
+            parity ^= 1;
+        }
+    }
+    int blank = 0;
+    while(cellGet(cells, width, blank) != 0) blank++;
+    int blank_parity = ((size-1 - blank/size) + (size-1 - blank%size)) % 2; // every move flips both parities
+    if(parity != blank_parity){ // swapping two tiles flips only the permutation, pairing up solvable and unsolvable boards
+        int first = blank == 0 ? 1 : 0;
+        int second = blank == first+1 ? first+2 : first+1;
+        uint32_t tile = cellGet(cells, width, first);
+        cellSet(cells, width, first, cellGet(cells, width, second));
+        cellSet(cells, width, second, tile);
+    }
+}
+
+/**
+ * Makes a board by moving random tiles from the won board, never undoing the move before
+ * @param g the generator
+ * @param cells filled with the tiles of the board, row after row, cellWidth(size) bytes each
+ * @param size the size of the square matrix (gameboard)
+ * @param moves the number of moves to make, more moves give harder boards
+ */
+void generateWalk(struct generator *g, unsigned char *cells, int size, int moves){
+    int count = size*size;
+    int width = cellWidth(size);
+    for(int i = 0; i<count-1;i++){
+        cellSet(cells, width, i, i+1);
+    }
+    cellSet(cells, width, count-1, 0);
+    int blank = count-1;
+    int previous = -1; // cell the empty slot came from
+    for(int move = 0; move<moves;move++){
+        int options[4];
+        int option_count = 0;
+        if(blank >= size && blank-size != previous) options[option_count++] = blank-size;
+        if(blank < count-size && blank+size != previous) options[option_count++] = blank+size;
+        if(blank%size > 0 && blank-1 != previous) options[option_count++] = blank-1;
+        if(blank%size < size-1 && blank+1 != previous) options[option_count++] = blank+1;
+        int next = options[generatorBelow(g, option_count)];
+        cellSet(cells, width, blank, cellGet(cells, width, next)); // the tile slides into the empty slot
+        cellSet(cells, width, next, 0);
+        previous = blank;
+        blank = next;
+    }
+}
+
+/**
+ * Writes a corpus of boards to a save file. Records are built in a buffer and written a
+ * chunk at a time, so the file streams out as fast as the disk takes it
+ * @param filename the name of the file
+ * @param size the size of the square matrix (gameboard)
+ * @param count the number of boards
+ * @param moves the length of the random walk of each board, 0 for uniform boards
+ * @param seed the seed, the same seed gives the same file
+ * @return true if the file was written
+ */
+bool generateFile(const char *filename, int size, unsigned long count, int moves, uint64_t seed){
+    if(size < 2 || size > SAVE_MAX_SIZE || count > UINT32_MAX) return false;
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+    size_t record = saveRecordBytes(size);
+    size_t per_chunk = GENERATE_CHUNK / record + 1; // a board larger than a chunk gets a chunk of its own
+    unsigned char *buffer = malloc(per_chunk * record);
+    unsigned char *cells = malloc((size_t)size * size * cellWidth(size));
+    bool written = buffer != NULL && cells != NULL;
+    struct save_header header;
+    saveHeader(&header, count, 0); // filled in once the checksum is known
+    written = written && write(fd, &header, sizeof(header)) == sizeof(header);
+    struct generator g;
+    generatorSeed(&g, seed);
+    uint32_t checksum = saveChecksumStart(count);
+    for(unsigned long done = 0; written && done<count;){
+        unsigned char *end = buffer;
+        for(size_t i = 0; i<per_chunk && done<count;i++, done++){
+            if(moves > 0)
+                generateWalk(&g, cells, size, moves);
+            else
+                generateUniform(&g, cells, size);
+            end = packRecord(end, cells, size);
+        }
+        checksum = saveChecksum(checksum, buffer, end - buffer);
+        written = write(fd, buffer, end - buffer) == end - buffer;
+    }
+    free(buffer);
+    free(cells);
+    saveHeader(&header, count, checksum);
+    written = written && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    close(fd);
+    return written;
+}
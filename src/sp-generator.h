@@ -0,0 +1,21 @@
+#ifndef SP_GENERATOR
+#define SP_GENERATOR
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A xoshiro256** random number generator, every stream is fixed by its seed
+ */
+struct generator {
+    uint64_t state[4];
+};
+
+void generatorSeed(struct generator *g, uint64_t seed);
+uint64_t generatorNext(struct generator *g);
+uint32_t generatorBelow(struct generator *g, uint32_t bound);
+void generateUniform(struct generator *g, unsigned char *cells, int size);
+void generateWalk(struct generator *g, unsigned char *cells, int size, int moves);
+bool generateFile(const char *filename, int size, unsigned long count, int moves, uint64_t seed);
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * A @code sp-journal records the moves of a game two bits at a time, as the direction the
+ * empty slot went, which is all undo and redo need. A session server can also append the
+ * changes to its games to a write-ahead log, so a crash loses nothing written since the
+ * last checkpoint: the checkpoint is loaded and the log replayed on top of it. The latest
+ * moves are also kept as a history, from which a client is sent only the cells that changed.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sp-journal.h"
+#include "sp-save.h"
+
+/**
+ * Records a move, dropping the moves that were undone
+ * @param journal pointer to the journal, NULL until the first move
+ * @param direction the direction the empty slot moved in
+ * @return false if memory ran out, the journal is then left as it was
+ */
+bool journalPush(struct journal **journal, int direction){
+    struct journal *j = *journal;
+    if(j == NULL){
+        j = calloc(1, sizeof(struct journal));
+        if(j == NULL) return false;
+        *journal = j;
+    }
+    if(j->position == j->capacity){ // grows before dropping anything, so a failure keeps what could be redone
+        uint32_t capacity = j->capacity == 0 ? 64 : j->capacity * 2;
+        uint8_t *moves = realloc(j->moves, capacity / 4);
+        if(moves == NULL) return false;
+        j->moves = moves;
+        j->capacity = capacity;
+    }
+    j->length = j->position; // a new move forgets what could be redone
+    uint32_t index = j->length++;
+    int shift = (index & 3) * 2;
+    j->moves[index >> 2] = (j->moves[index >> 2] & ~(3 << shift)) | (direction << shift);
+    j->position = j->length;
+    return true;
+}
+
+/**
+ * Frees a journal
+ * @param journal the journal, may be NULL
+ */
+void journalFree(struct journal *journal){
+    if(journal == NULL) return;
+    free(journal->moves);
+    free(journal);
+}
+
+/**
+ * Starts a history for a board, at version 0 of a board number not used before
+ * @return the history, NULL if memory ran out
+ */
+struct history *historyCreate(){
+    static uint32_t boards = 0; // histories created so far
+    struct history *history = malloc(sizeof(struct history));
+    if(history == NULL) return NULL;
+    history->board = ++boards;
+    history->moves = 0;
+    return history;
+}
+
+/**
+ * Records a move in a history, the oldest one is forgotten once it is full
+ * @param history the history
+ * @param direction the direction the empty slot moved in
+ */
+void historyPush(struct history *history, int direction){
+    uint32_t index = history->moves++ % HISTORY_MOVES;
+    int shift = (index & 3) * 2;
+    history->directions[index >> 2] = (history->directions[index >> 2] & ~(3 << shift)) | (direction << shift);
+}
+
+/**
+ * Makes room at the end of the records waiting to be written
+ * @param wal the log
+ * @param length the number of bytes
+ * @return where the bytes go, NULL if memory ran out or a record was already lost
+ */
+static unsigned char *walReserve(struct wal *wal, size_t length){
+    if(wal->lost) return NULL; // a record after a gap would be replayed on the wrong board
+    if(wal->length + length > wal->capacity){
+        size_t capacity = wal->capacity == 0 ? 4096 : wal->capacity;
+        while(capacity < wal->length + length) capacity *= 2;
+        unsigned char *buffer = realloc(wal->buffer, capacity);
+        if(buffer == NULL){
+            wal->lost = true; // the change stays in memory, only a checkpoint can save it now
+            return NULL;
+        }
+        wal->buffer = buffer;
+        wal->capacity = capacity;
+    }
+    unsigned char *end = wal->buffer + wal->length;
+    wal->length += length;
+    return end;
+}
+
+/**
+ * Appends bytes to the records waiting to be written
+ * @param wal the log
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return false if the bytes couldn't be kept
+ */
+static bool walAppend(struct wal *wal, const void *data, size_t length){
+    unsigned char *end = walReserve(wal, length);
+    if(end != NULL) memcpy(end, data, length);
+    return end != NULL;
+}
+
+/**
+ * Starts the log over with a header naming the checkpoint it follows
+ * @param wal the log
+ * @param checkpoint the checksum of the checkpoint, 0 if there is none
+ * @return false if the file couldn't be written
+ */
+bool walReset(struct wal *wal, uint32_t checkpoint){
+    wal->length = 0;
+    wal->lost = false; // the checkpoint holds every change made so far
+    if(ftruncate(wal->fd, 0) < 0) return false;
+    walAppend(wal, WAL_MAGIC, 4);
+    walAppend(wal, &checkpoint, sizeof(checkpoint));
+    return walFlush(wal);
+}
+
+/**
+ * Opens a log for appending, starting it over
+ * @param filename the name of the file
+ * @param checkpoint the checksum of the checkpoint it follows, 0 if there is none
+ * @return the log, NULL if it couldn't be opened
+ */
+struct wal *walOpen(const char *filename, uint32_t checkpoint){
+    struct wal *wal = calloc(1, sizeof(struct wal));
+    if(wal == NULL) return NULL;
+    wal->fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(wal->fd < 0 || !walReset(wal, checkpoint)){
+        if(wal->fd >= 0) close(wal->fd);
+        free(wal->buffer);
+        free(wal);
+        return NULL;
+    }
+    return wal;
+}
+
+/**
+ * Logs a move, five bytes
+ * @param wal the log
+ * @param session the session the move was made in
+ * @param direction the direction the empty slot moved in
+ * @return false if the move couldn't be logged, the log then waits for a checkpoint
+ */
+bool walMove(struct wal *wal, uint32_t session, int direction){
+    unsigned char record[5] = {direction};
+    memcpy(record + 1, &session, sizeof(session));
+    return walAppend(wal, record, sizeof(record));
+}
+
+/**
+ * Logs a whole board, for a new or loaded game or a closed session
+ * @param wal the log
+ * @param session the session of the board
+ * @param cells the tiles of the board, row after row, cellWidth(size) bytes each, NULL for a closed session
+ * @param size the size of the square matrix (gameboard)
+ * @return false if the board couldn't be logged, the log then waits for a checkpoint
+ */
+bool walBoard(struct wal *wal, uint32_t session, const unsigned char *cells, int size){
+    if(cells == NULL) size = 0;
+    unsigned char *record = walReserve(wal, 5 + saveRecordBytes(size)); // the board is packed straight into the log
+    if(record == NULL) return false;
+    record[0] = WAL_BOARD;
+    memcpy(record + 1, &session, sizeof(session));
+    packRecord(record + 5, cells, size);
+    return true;
+}
+
+/**
+ * Writes the waiting records to the file, called before the replies they belong to are sent
+ * @param wal the log
+ * @return false if the file couldn't be written or a record was lost, a checkpoint must then be written before the replies go out
+ */
+bool walFlush(struct wal *wal){
+    size_t written = 0;
+    while(!wal->lost && written < wal->length){
+        ssize_t n = write(wal->fd, wal->buffer + written, wal->length - written);
+        if(n <= 0) wal->lost = true; // what reached the file is still a whole prefix of the changes, nothing more may follow it
+        else written += n;
+    }
+    if(wal->lost){
+        wal->length = 0;
+        return false;
+    }
+    wal->length = 0;
+    return true;
+}
+
+/**
+ * Reads the records of a log, if it follows the checkpoint that was loaded
+ * @param filename the name of the file
+ * @param checkpoint the checksum of the checkpoint that was loaded, 0 if there was none
+ * @param length filled with the number of bytes of records
+ * @return the records to be freed by the caller, NULL if there are none to replay
+ */
+unsigned char *walRead(const char *filename, uint32_t checkpoint, size_t *length){
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) return NULL;
+    struct stat status;
+    unsigned char *records = NULL;
+    unsigned char header[8];
+    if(fstat(fd, &status) == 0 && status.st_size > (off_t)sizeof(header) && read(fd, header, sizeof(header)) == sizeof(header)
+        && memcmp(header, WAL_MAGIC, 4) == 0 && memcmp(header + 4, &checkpoint, sizeof(checkpoint)) == 0){ // a log of an older checkpoint is already in the newer one
+        *length = status.st_size - sizeof(header);
+        records = malloc(*length);
+        if(records != NULL && read(fd, records, *length) != (ssize_t)*length){
+            free(records);
+            records = NULL;
+        }
+    }
+    close(fd);
+    return records;
+}
@@ -0,0 +1,79 @@
+#ifndef SP_JOURNAL
+#define SP_JOURNAL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DIRECTION_UP 0 // directions the empty slot moves in, the opposite of d is d^1
+#define DIRECTION_DOWN 1
+#define DIRECTION_LEFT 2
+#define DIRECTION_RIGHT 3
+
+#define HISTORY_MOVES 4096 // latest moves a game keeps for delta sync, a kilobyte
+#define WAL_MAGIC "SPWL" // first bytes of a write-ahead log
+#define WAL_BOARD 4 // kind of a log record holding a whole board, kinds below it are moves
+
+/**
+ * The moves made in a game, two bits each. Moves past the position were undone and can be redone
+ */
+struct journal {
+    uint32_t length; // moves recorded
+    uint32_t position; // moves in effect, the rest were undone
+    uint32_t capacity; // moves that fit in the buffer
+    uint8_t *moves; // four moves per byte
+};
+
+/**
+ * The latest moves of the empty slot, undone and redone ones included, so a client can be sent the cells that changed since it last looked
+ */
+struct history {
+    uint32_t board; // which board the versions belong to, no two histories of a process share it
+    uint32_t moves; // moves made since the history started, the version of the board
+    uint8_t directions[HISTORY_MOVES / 4]; // the last HISTORY_MOVES moves, four per byte, move m is at m % HISTORY_MOVES
+};
+
+/**
+ * A write-ahead log of the changes made to the games of a session server since its last checkpoint
+ */
+struct wal {
+    int fd;
+    unsigned char *buffer; // records not written yet
+    size_t length;
+    size_t capacity;
+    bool lost; // a record couldn't be kept, so nothing more is logged until the log starts over from a checkpoint
+};
+
+/**
+ * Reads the direction of a recorded move
+ * @param journal the journal
+ * @param index the move
+ * @return the direction the empty slot moved in
+ */
+static inline int journalGet(const struct journal *journal, uint32_t index){
+    return (journal->moves[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+/**
+ * Reads the direction of a move kept in a history
+ * @param history the history
+ * @param move the move, one of the last HISTORY_MOVES
+ * @return the direction the empty slot moved in
+ */
+static inline int historyGet(const struct history *history, uint32_t move){
+    uint32_t index = move % HISTORY_MOVES;
+    return (history->directions[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+bool journalPush(struct journal **journal, int direction);
+void journalFree(struct journal *journal);
+struct history *historyCreate();
+void historyPush(struct history *history, int direction);
+struct wal *walOpen(const char *filename, uint32_t checkpoint);
+bool walMove(struct wal *wal, uint32_t session, int direction);
+bool walBoard(struct wal *wal, uint32_t session, const unsigned char *cells, int size);
+bool walFlush(struct wal *wal);
+bool walReset(struct wal *wal, uint32_t checkpoint);
+unsigned char *walRead(const char *filename, uint32_t checkpoint, size_t *length);
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * A @code sp-kernels holds the functions that move tiles, specialized for each common board
+ * size. The makefile writes the sizes to sp-kernel-sizes.h as KERNELS(n) lines, and each one
+ * compiles the functions with the size a constant and the cells a byte each, so the loop
+ * bounds, strides and divisions become constants. Other sizes use the functions for any size.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "sp-kernels.h"
+#include "sp-journal.h"
+
+/**
+ * Checks whether a tile is next to the empty slot, on a board of any size
+ * @param game the game
+ * @param tile the value of the tile entry
+ * @return true if the move valid and false otherwise
+ */
+static bool validAny(struct game *game, int tile){
+    int size = game->size;
+    if(tile < 1 || tile > (size*size)-1) // exceeds the lower and upper bounds of the gameboard
+        return false;
+    int tile_slot = tile_position(game, tile);
+    int distance = abs(tile_slot - (int)game->blank_position);
+    if(distance == size) // the tile is directly above or below the empty slot
+        return true;
+    if(distance == 1 && (tile_slot/size) == (game->blank_position/size)) // the tile is next to the empty slot on the same row
+        return true;
+    return false;
+}
+
+/**
+ * Swaps a tile with the empty slot, on a board of any size
+ * @param game the game
+ * @param tile the value to swap with 0
+ */
+static void moveAny(struct game *game, int tile){
+    int tile_slot = tile_position(game, tile);
+    int blank_slot = game->blank_position;
+    game->correct_tiles += (blank_slot == tile-1) - (tile_slot == tile-1); // the tile either lands in or leaves its winning cell
+    place_tile(game, tile_slot, 0); // the tile's entry location becomes the empty slot
+    place_tile(game, blank_slot, tile); // the old empty slot now holds the tile
+    game->blank_position = tile_slot;
+}
+
+/**
+ * Finds the cell the empty slot moves to, on a board of any size
+ * @param game the game
+ * @param direction the direction the empty slot moves in
+ * @return the index of the cell, -1 if the empty slot is at that edge of the board
+ */
+static int neighbourAny(struct game *game, int direction){
+    int size = game->size;
+    int blank = game->blank_position;
+    switch(direction){
+        case DIRECTION_UP: return blank >= size ? blank-size : -1;
+        case DIRECTION_DOWN: return blank < size*size-size ? blank+size : -1;
+        case DIRECTION_LEFT: return blank%size > 0 ? blank-1 : -1;
+        default: return blank%size < size-1 ? blank+1 : -1;
+    }
+}
+
+/**
+ * The same three functions for one size, whose cells and tile index entries are a byte each.
+ * The row check of a sideways move divides by a constant, which compiles to a multiply
+ */
+#define KERNELS(N) \
+static bool valid##N(struct game *game, int tile){ \
+    if((unsigned int)(tile-1) >= N*N-1) return false; /* tiles below 1 wrap around too */ \
+    int tile_slot = game->gameboard[N*N + tile]; \
+    int blank = game->blank_position; \
+    int distance = tile_slot - blank; \
+    return (distance == N) | (distance == -N) | (((distance == 1) | (distance == -1)) & (tile_slot/N == blank/N)); \
+} \
+static void move##N(struct game *game, int tile){ \
+    unsigned char *cells = game->gameboard; \
+    unsigned char *position = cells + N*N; \
+    int tile_slot = position[tile]; \
+    int blank_slot = game->blank_position; \
+    game->correct_tiles += (blank_slot == tile-1) - (tile_slot == tile-1); \
+    cells[tile_slot] = 0; \
+    cells[blank_slot] = tile; \
+    position[tile] = blank_slot; \
+    position[0] = tile_slot; \
+    game->blank_position = tile_slot; \
+} \
+static int neighbour##N(struct game *game, int direction){ \
+    int blank = game->blank_position; \
+    switch(direction){ \
+        case DIRECTION_UP: return blank >= N ? blank-N : -1; \
+        case DIRECTION_DOWN: return blank < N*N-N ? blank+N : -1; \
+        case DIRECTION_LEFT: return blank%N > 0 ? blank-1 : -1; \
+        default: return blank%N < N-1 ? blank+1 : -1; \
+    } \
+}
+#include "sp-kernel-sizes.h"
+#undef KERNELS
+
+#define KERNELS(N) [N] = {valid##N, move##N, neighbour##N},
+const struct kernels board_kernels[KERNEL_TABLE] = {
+    [0] = {validAny, moveAny, neighbourAny},
+#include "sp-kernel-sizes.h"
+};
+#undef KERNELS
+
+/**
+ * Picks the kernels of a board, once when the game is made
+ * @param size the size of the square matrix (gameboard)
+ * @return the entry of board_kernels to use, 0 if the size has no kernels of its own
+ */
+int kernelFor(int size){
+    if(size >= KERNEL_TABLE || cellWidth(size) != 1 || board_kernels[size].move == NULL) return 0;
+    return size;
+}
@@ -0,0 +1,23 @@
+#ifndef SP_KERNELS
+#define SP_KERNELS
+
+#include <stdbool.h>
+#include "sp-pipe-server.h"
+
+#define KERNEL_TABLE 16 // board_kernels[size] for every size a byte per cell holds, 0 is for any size
+
+/**
+ * The functions that move tiles on a game, compiled once for each size in KERNEL_SIZES of the
+ * makefile with the size as a constant, and once more for any size
+ */
+struct kernels {
+    bool (*valid)(struct game *game, int tile); // whether a tile is next to the empty slot
+    void (*move)(struct game *game, int tile); // swaps a tile with the empty slot
+    int (*neighbour)(struct game *game, int direction); // the cell the empty slot moves to in a direction, -1 at the edge
+};
+
+extern const struct kernels board_kernels[KERNEL_TABLE];
+
+int kernelFor(int size);
+
+#endif
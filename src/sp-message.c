@@ -0,0 +1,170 @@
+/**
+ * A @code sp-message frames the requests and replies exchanged by the client and the
+ * server. A frame is the length of its body followed by the body, so a whole request
+ * or reply travels in a single write no matter how many fields it holds.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "sp-message.h"
+
+/**
+ * Empties a message so a new frame can be built or received in it
+ * @param m the message
+ */
+void messageReset(struct message *m){
+    m->length = FRAME_HEADER;
+    m->offset = FRAME_HEADER;
+}
+
+/**
+ * Makes room at the end of a message
+ * @param m the message
+ * @param length the number of bytes to add
+ * @return where the bytes go, or NULL if memory ran out
+ */
+void *messageReserve(struct message *m, size_t length){
+    if(m->length < FRAME_HEADER) messageReset(m);
+    if(m->length + length > m->capacity){
+        size_t capacity = m->capacity == 0 ? 256 : m->capacity;
+        while(capacity < m->length + length) capacity *= 2;
+        char *data = realloc(m->data, capacity);
+        if(data == NULL) return NULL;
+        m->data = data;
+        m->capacity = capacity;
+    }
+    void *end = m->data + m->length;
+    m->length += length;
+    return end;
+}
+
+/**
+ * Appends a field to a message
+ * @param m the message
+ * @param data the field
+ * @param length the size of the field
+ * @return false if memory ran out
+ */
+bool messageWrite(struct message *m, const void *data, size_t length){
+    void *end = messageReserve(m, length);
+    if(end == NULL) return false;
+    memcpy(end, data, length);
+    return true;
+}
+
+/**
+ * Takes the next field out of a message
+ * @param m the message
+ * @param data filled with the field
+ * @param length the size of the field
+ * @return false if the message is too short, data is then zeroed
+ */
+bool messageRead(struct message *m, void *data, size_t length){
+    if(messageRemaining(m) < length){
+        memset(data, 0, length);
+        m->offset = m->length;
+        return false;
+    }
+    memcpy(data, m->data + m->offset, length);
+    m->offset += length;
+    return true;
+}
+
+/**
+ * Counts the bytes of a message not read yet
+ * @param m the message
+ * @return the number of bytes left
+ */
+size_t messageRemaining(const struct message *m){
+    return m->length > m->offset ? m->length - m->offset : 0;
+}
+
+/**
+ * Turns a reply into one telling the client its request couldn't be answered
+ * @param m the reply, whatever it held is dropped
+ * @param status why, ERROR_SESSION or ERROR_COMMAND
+ * @return false if memory ran out
+ */
+bool messageError(struct message *m, uint32_t status){
+    uint32_t error[2] = {REPLY_ERROR, status};
+    messageReset(m);
+    return messageWrite(m, error, sizeof(error));
+}
+
+/**
+ * Tells whether a received reply says the request couldn't be answered
+ * @param m the reply, ready to be read from its body
+ * @return the status the server gave, 0 for an answer
+ */
+uint32_t messageStatus(const struct message *m){
+    uint32_t error[2];
+    if(m->length - m->offset != sizeof(error)) return 0;
+    memcpy(error, m->data + m->offset, sizeof(error));
+    return error[0] == REPLY_ERROR ? error[1] : 0;
+}
+
+/**
+ * Frees the buffer of a message
+ * @param m the message
+ */
+void messageFree(struct message *m){
+    free(m->data);
+    m->data = NULL;
+    m->length = m->capacity = m->offset = 0;
+}
+
+/**
+ * Writes a whole message as one frame
+ * @param fd where to write
+ * @param m the message, its header is filled in
+ * @return false if the peer is gone
+ */
+bool sendFrame(int fd, struct message *m){
+    if(messageReserve(m, 0) == NULL) return false;
+    uint32_t body = m->length - FRAME_HEADER;
+    memcpy(m->data, &body, FRAME_HEADER);
+    for(size_t sent = 0; sent < m->length;){
+        ssize_t n = write(fd, m->data + sent, m->length - sent);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * Reads bytes until all of them have arrived
+ * @param fd where to read
+ * @param data filled with the bytes
+ * @param length the number of bytes
+ * @return false if the peer is gone
+ */
+static bool readAll(int fd, void *data, size_t length){
+    for(size_t got = 0; got < length;){
+        ssize_t n = read(fd, (char *)data + got, length - got);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+/**
+ * Waits for a whole frame and puts it in a message, ready to be read from its body
+ * @param fd where to read
+ * @param m filled with the frame
+ * @return false if the peer is gone or sent a frame that is too large
+ */
+bool receiveFrame(int fd, struct message *m){
+    uint32_t body;
+    if(!readAll(fd, &body, sizeof(body)) || body > FRAME_MAX) return false;
+    messageReset(m);
+    void *data = messageReserve(m, body);
+    if(data == NULL) return false;
+    return readAll(fd, data, body);
+}
@@ -0,0 +1,35 @@
+#ifndef SP_MESSAGE
+#define SP_MESSAGE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_HEADER sizeof(uint32_t) // every frame starts with the length of its body
+#define FRAME_MAX (64u << 20) // largest body a peer will accept
+#define REPLY_ERROR 0x52524553u // first word of a reply the server couldn't answer, no answer is this word and one more
+#define ERROR_SESSION 1 // the request named a session the server doesn't have
+#define ERROR_COMMAND 2 // the server doesn't know the type of request
+
+/**
+ * A growable buffer holding one frame, the first FRAME_HEADER bytes are kept for the length
+ */
+struct message {
+    char *data; // the frame, header included
+    size_t length; // bytes used, header included
+    size_t capacity; // bytes allocated
+    size_t offset; // next byte to read
+};
+
+void messageReset(struct message *m);
+bool messageWrite(struct message *m, const void *data, size_t length);
+void *messageReserve(struct message *m, size_t length);
+bool messageRead(struct message *m, void *data, size_t length);
+size_t messageRemaining(const struct message *m);
+bool messageError(struct message *m, uint32_t status);
+uint32_t messageStatus(const struct message *m);
+void messageFree(struct message *m);
+bool sendFrame(int fd, struct message *m);
+bool receiveFrame(int fd, struct message *m);
+
+#endif
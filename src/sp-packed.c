@@ -0,0 +1,194 @@
+/**
+ * A @code sp-packed stores boards up to 4x4 in a single 64 bit word, 4 bits per cell,
+ * and measures their manhattan distance with SSSE3 or AVX2 when the processor has them.
+ * The vector kernels spread the 16 nibbles over 16 bytes and look up the winning row and
+ * column of every tile at once with byte shuffles.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "sp-packed.h"
+
+#ifdef __x86_64__ // the 64 bit lane moves only exist there, other machines take the loops below
+#include <immintrin.h>
+#define PACKED_SIMD
+#endif
+
+/**
+ * Packs a board of ints
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard), at most PACKED_MAX_SIZE
+ * @return the packed board
+ */
+packed_state packState(const int *board, int size){
+    packed_state state = 0;
+    for(int i = 0; i<size*size;i++){
+        state |= (packed_state)board[i] << (4*i);
+    }
+    return state;
+}
+
+/**
+ * Packs a board of bytes
+ * @param cells the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard), at most PACKED_MAX_SIZE
+ * @return the packed board
+ */
+packed_state packCells(const unsigned char *cells, int size){
+    packed_state state = 0;
+    for(int i = 0; i<size*size;i++){
+        state |= (packed_state)cells[i] << (4*i);
+    }
+    return state;
+}
+
+/**
+ * Sums the manhattan distances one cell at a time
+ * @param state the packed board
+ * @param size the size of the square matrix (gameboard)
+ * @return the manhattan distance of the board
+ */
+static int manhattanScalar(packed_state state, int size){
+    int distance = 0;
+    for(int cell = 0; cell<size*size;cell++){
+        int tile = packedTile(state, cell);
+        if(tile == 0) continue;
+        distance += abs(cell/size - (tile-1)/size) + abs(cell%size - (tile-1)%size);
+    }
+    return distance;
+}
+
+#ifdef PACKED_SIMD
+
+/**
+ * Byte tables for one board size, lane i of a row table belongs to cell i and
+ * lane t of a goal table belongs to tile t
+ */
+struct lanes {
+    unsigned char cell_row[16];
+    unsigned char cell_column[16];
+    unsigned char goal_row[16];
+    unsigned char goal_column[16];
+};
+
+static struct lanes tables[PACKED_MAX_SIZE+1]; // tables[size], filled on first use
+static bool tables_ready = false;
+
+/**
+ * Fills the byte tables of every board size
+ */
+static void fillTables(){
+    for(int size = 1; size<=PACKED_MAX_SIZE;size++){
+        for(int i = 0; i<16;i++){
+            tables[size].cell_row[i] = i/size;
+            tables[size].cell_column[i] = i%size;
+            tables[size].goal_row[i] = i == 0 ? 0 : (i-1)/size; // the empty slot is masked out later
+            tables[size].goal_column[i] = i == 0 ? 0 : (i-1)%size;
+        }
+    }
+    __atomic_store_n(&tables_ready, true, __ATOMIC_RELEASE); // every thread fills the same values, so racing is harmless
+}
+
+/**
+ * Spreads the 16 nibbles of a packed board over the 16 bytes of a vector
+ * @param state the packed board
+ * @return lane i holds the tile of cell i
+ */
+__attribute__((target("ssse3")))
+static __m128i spreadNibbles(packed_state state){
+    __m128i even = _mm_cvtsi64_si128(state & 0x0F0F0F0F0F0F0F0Full); // cells 0, 2, 4, ...
+    __m128i odd = _mm_cvtsi64_si128((state >> 4) & 0x0F0F0F0F0F0F0F0Full); // cells 1, 3, 5, ...
+    return _mm_unpacklo_epi8(even, odd);
+}
+
+/**
+ * Manhattan distance of one packed board with 16 byte lanes
+ * @param state the packed board
+ * @param size the size of the square matrix (gameboard)
+ * @return the manhattan distance of the board
+ */
+__attribute__((target("ssse3")))
+static int manhattanSSSE3(packed_state state, int size){
+    const struct lanes *t = &tables[size];
+    __m128i tiles = spreadNibbles(state);
+    __m128i rows = _mm_abs_epi8(_mm_sub_epi8(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t->goal_row), tiles),
+        _mm_loadu_si128((const __m128i *)t->cell_row)));
+    __m128i columns = _mm_abs_epi8(_mm_sub_epi8(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)t->goal_column), tiles),
+        _mm_loadu_si128((const __m128i *)t->cell_column)));
+    __m128i distances = _mm_andnot_si128(_mm_cmpeq_epi8(tiles, _mm_setzero_si128()), _mm_add_epi8(rows, columns)); // the empty slot and unused cells count 0
+    __m128i sums = _mm_sad_epu8(distances, _mm_setzero_si128());
+    return _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+}
+
+/**
+ * Manhattan distances of two packed boards at a time with 32 byte lanes
+ * @param states the packed boards
+ * @param count the number of boards
+ * @param size the size of the square matrix (gameboard)
+ * @param distances filled with the manhattan distance of each board
+ */
+__attribute__((target("avx2")))
+static void manhattanBatchAVX2(const packed_state *states, int count, int size, unsigned char *distances){
+    const struct lanes *t = &tables[size];
+    __m256i cell_row = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t->cell_row));
+    __m256i cell_column = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t->cell_column));
+    __m256i goal_row = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t->goal_row));
+    __m256i goal_column = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t->goal_column));
+    __m256i nibbles = _mm256_set1_epi8(0x0F);
+    int i = 0;
+    for(; i+1<count;i+=2){
+        __m256i packed = _mm256_set_epi64x(0, states[i+1], 0, states[i]); // one board per 128 bit lane
+        __m256i even = _mm256_and_si256(packed, nibbles);
+        __m256i odd = _mm256_and_si256(_mm256_srli_epi64(packed, 4), nibbles);
+        __m256i tiles = _mm256_unpacklo_epi8(even, odd);
+        __m256i rows = _mm256_abs_epi8(_mm256_sub_epi8(_mm256_shuffle_epi8(goal_row, tiles), cell_row));
+        __m256i columns = _mm256_abs_epi8(_mm256_sub_epi8(_mm256_shuffle_epi8(goal_column, tiles), cell_column));
+        __m256i blanks = _mm256_cmpeq_epi8(tiles, _mm256_setzero_si256());
+        __m256i sums = _mm256_sad_epu8(_mm256_andnot_si256(blanks, _mm256_add_epi8(rows, columns)), _mm256_setzero_si256());
+        distances[i] = _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1);
+        distances[i+1] = _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+    for(; i<count;i++){
+        distances[i] = manhattanSSSE3(states[i], size);
+    }
+}
+
+#endif
+
+/**
+ * Sums the manhattan distances of every tile of a packed board
+ * @param state the packed board
+ * @param size the size of the square matrix (gameboard), at most PACKED_MAX_SIZE
+ * @return the manhattan distance of the board
+ */
+int packedManhattan(packed_state state, int size){
+#ifdef PACKED_SIMD
+    if(__builtin_cpu_supports("ssse3")){
+        if(!__atomic_load_n(&tables_ready, __ATOMIC_ACQUIRE)) fillTables();
+        return manhattanSSSE3(state, size);
+    }
+#endif
+    return manhattanScalar(state, size);
+}
+
+/**
+ * Sums the manhattan distances of many packed boards
+ * @param states the packed boards
+ * @param count the number of boards
+ * @param size the size of the square matrix (gameboard), at most PACKED_MAX_SIZE
+ * @param distances filled with the manhattan distance of each board
+ */
+void packedManhattanBatch(const packed_state *states, int count, int size, unsigned char *distances){
+#ifdef PACKED_SIMD
+    if(__builtin_cpu_supports("avx2")){
+        if(!__atomic_load_n(&tables_ready, __ATOMIC_ACQUIRE)) fillTables();
+        manhattanBatchAVX2(states, count, size, distances);
+        return;
+    }
+#endif
+    for(int i = 0; i<count;i++){
+        distances[i] = packedManhattan(states[i], size);
+    }
+}
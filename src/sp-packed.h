@@ -0,0 +1,61 @@
+#ifndef SP_PACKED
+#define SP_PACKED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACKED_MAX_SIZE 4 // a 4x4 board has 16 tiles of 4 bits, exactly 64 bits
+
+typedef uint64_t packed_state; // the tile of cell i sits in bits 4i to 4i+3, unused cells are 0
+
+packed_state packState(const int *board, int size);
+packed_state packCells(const unsigned char *cells, int size);
+int packedManhattan(packed_state state, int size);
+void packedManhattanBatch(const packed_state *states, int count, int size, unsigned char *distances);
+
+/**
+ * Reads the tile of one cell
+ * @param state the packed board
+ * @param cell the index of the cell
+ * @return the tile in the cell
+ */
+static inline int packedTile(packed_state state, int cell){
+    return (state >> (4*cell)) & 0xF;
+}
+
+/**
+ * Slides the tile of a cell into the empty slot
+ * @param state the packed board
+ * @param blank the index of the empty slot
+ * @param cell the index of the tile's cell, next to the empty slot
+ * @return the packed board after the move
+ */
+static inline packed_state packedMove(packed_state state, int blank, int cell){
+    uint64_t tile = (state >> (4*cell)) & 0xF;
+    return (state & ~(0xFull << (4*cell))) | (tile << (4*blank)); // the empty slot's nibble is already 0
+}
+
+/**
+ * Mixes the bits of a packed board into a well spread hash
+ * @param state the packed board
+ * @return the hash
+ */
+static inline uint64_t packedHash(packed_state state){
+    state ^= state >> 30;
+    state *= 0xbf58476d1ce4e5b9ull;
+    state ^= state >> 27;
+    state *= 0x94d049bb133111ebull;
+    return state ^ (state >> 31);
+}
+
+/**
+ * Compares two packed boards
+ * @param a the first packed board
+ * @param b the second packed board
+ * @return true if every cell holds the same tile
+ */
+static inline bool packedEqual(packed_state a, packed_state b){
+    return a == b;
+}
+
+#endif
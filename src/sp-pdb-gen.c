@@ -0,0 +1,173 @@
+/**
+ * A @code sp-pdb-gen builds the pattern database file of a board size. Each pattern
+ * is searched breadth first from its winning placement, counting only the moves of the
+ * pattern's own tiles. Counting no other tile keeps the tables of different patterns
+ * additive.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sp-pdb.h"
+
+#define UNSEEN 0xFF // table entry not reached yet
+#define PAGE 4096 // tables start on page boundaries so they map cleanly
+
+/**
+ * Fills a pattern's table by searching breadth first one layer at a time. A state is a
+ * placement of the pattern's tiles plus the cell of the empty slot. Sliding any other tile
+ * is free, so the empty slot wanders for free through the cells the pattern leaves open,
+ * and each layer is first closed over those free moves before its paid moves are taken.
+ * The layers are bitmaps so the memory used stays close to one bit per state.
+ * @param table filled with the fewest moves from each placement, over all cells of the empty slot
+ * @param tiles the tiles of the pattern
+ * @param count the number of tiles in the pattern
+ * @param size the size of the square matrix (gameboard)
+ * @return false if memory ran out
+ */
+static bool buildTable(unsigned char *table, const unsigned char *tiles, int count, int size){
+    int cells = size*size;
+    unsigned long entries = pdbEntries(count, cells);
+    size_t words = (entries*cells + 63) / 64; // one bit per placement and empty slot cell
+    uint64_t *seen = calloc(words, sizeof(uint64_t)); // states already given a distance
+    uint64_t *layer = calloc(words, sizeof(uint64_t)); // states reached at the current depth
+    uint64_t *next = calloc(words, sizeof(uint64_t)); // states reached at the next depth
+    if(seen == NULL || layer == NULL || next == NULL){
+        free(seen);
+        free(layer);
+        free(next);
+        return false;
+    }
+    memset(table, UNSEEN, entries);
+    int positions[PDB_MAX_PATTERN_TILES];
+    for(int i = 0; i<count;i++){
+        positions[i] = tiles[i]-1; // tile t belongs in cell t-1
+    }
+    unsigned long start = pdbRank(positions, count, cells)*cells + cells-1; // the empty slot starts in the last cell
+    seen[start/64] |= 1ull << (start%64);
+    layer[start/64] |= 1ull << (start%64);
+    unsigned long reached = 1;
+    for(int depth = 0; reached > 0; depth++){
+        reached = 0;
+        for(size_t w = 0; w<words;w++){
+            while(layer[w] != 0){ // expanding a state clears the rest of its region from the layer
+                unsigned long state = w*64 + __builtin_ctzll(layer[w]);
+                unsigned long rank = state / cells;
+                pdbUnrank(rank, positions, count, cells);
+                if(table[rank] == UNSEEN) table[rank] = depth;
+                int owner[PDB_MAX_CELLS]; // owner[cell] is the pattern tile in the cell, or -1
+                for(int cell = 0; cell<cells;cell++){
+                    owner[cell] = -1;
+                }
+                for(int i = 0; i<count;i++){
+                    owner[positions[i]] = i;
+                }
+                int region[PDB_MAX_CELLS]; // cells the empty slot reaches for free
+                int region_size = 0;
+                unsigned int in_region = 1u << (state % cells);
+                region[region_size++] = state % cells;
+                for(int r = 0; r<region_size;r++){
+                    int blank = region[r];
+                    unsigned long here = rank*cells + blank;
+                    layer[here/64] &= ~(1ull << (here%64));
+                    seen[here/64] |= 1ull << (here%64);
+                    int neighbours[4];
+                    int moves = 0;
+                    if(blank >= size) neighbours[moves++] = blank - size;
+                    if(blank < cells-size) neighbours[moves++] = blank + size;
+                    if(blank%size > 0) neighbours[moves++] = blank - 1;
+                    if(blank%size < size-1) neighbours[moves++] = blank + 1;
+                    for(int m = 0; m<moves;m++){
+                        int cell = neighbours[m];
+                        if(owner[cell] == -1){ // another tile slides for free
+                            if(!(in_region & (1u << cell))){
+                                in_region |= 1u << cell;
+                                region[region_size++] = cell;
+                            }
+                            continue;
+                        }
+                        int i = owner[cell]; // a pattern tile slides into the empty slot and costs a move
+                        positions[i] = blank;
+                        unsigned long neighbour = pdbRank(positions, count, cells)*cells + cell;
+                        positions[i] = cell;
+                        if(!(seen[neighbour/64] & (1ull << (neighbour%64))) && !(next[neighbour/64] & (1ull << (neighbour%64)))){
+                            next[neighbour/64] |= 1ull << (neighbour%64);
+                            reached++;
+                        }
+                    }
+                }
+            }
+        }
+        for(size_t w = 0; w<words;w++){ // states seen at this depth through free moves aren't reached again
+            next[w] &= ~seen[w];
+        }
+        uint64_t *swap = layer;
+        layer = next;
+        next = swap;
+        fprintf(stderr, "  depth %d: %lu states\n", depth+1, reached);
+    }
+    free(seen);
+    free(layer);
+    free(next);
+    return true;
+}
+
+/**
+ * Builds every pattern of a board size and writes them to a file
+ * usage: sp-pdb-gen size output
+ */
+int main(int argc, char **argv){
+    if(argc != 3){
+        fprintf(stderr, "usage: %s size output\n", argv[0]);
+        return 1;
+    }
+    int size = atoi(argv[1]);
+    struct pdb_header header;
+    memset(&header, 0, sizeof(header));
+    int patterns = pdbPartition(size, header.tiles, header.tile_count);
+    if(patterns == 0){
+        fprintf(stderr, "No pattern partition for a %dx%d board\n", size, size);
+        return 1;
+    }
+    memcpy(header.magic, PDB_MAGIC, 4);
+    header.version = PDB_VERSION;
+    header.size = size;
+    header.patterns = patterns;
+    unsigned long long offset = PAGE;
+    for(int p = 0; p<patterns;p++){
+        header.offsets[p] = offset;
+        offset += (pdbEntries(header.tile_count[p], size*size) + PAGE-1) / PAGE * PAGE;
+    }
+    FILE *fp = fopen(argv[2], "wb");
+    if(fp == NULL){
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    for(int p = 0; p<patterns;p++){
+        unsigned long entries = pdbEntries(header.tile_count[p], size*size);
+        unsigned char *table = malloc(entries);
+        fprintf(stderr, "Pattern %d: %lu entries\n", p, entries);
+        if(table == NULL || !buildTable(table, header.tiles[p], header.tile_count[p], size)){
+            fprintf(stderr, "Out of memory\n");
+            fclose(fp);
+            remove(argv[2]);
+            return 1;
+        }
+        fseek(fp, header.offsets[p], SEEK_SET);
+        if(fwrite(table, 1, entries, fp) != entries){
+            fprintf(stderr, "Could not write %s\n", argv[2]);
+            fclose(fp);
+            remove(argv[2]);
+            return 1;
+        }
+        free(table);
+    }
+    fclose(fp);
+    return 0;
+}
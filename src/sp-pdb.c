@@ -0,0 +1,207 @@
+/**
+ * A @code sp-pdb holds the disjoint additive pattern databases used by the solver.
+ * The tiles of a board are split into patterns, and the table of a pattern stores how
+ * many moves of its own tiles are needed to bring them home from any placement. The
+ * tables are built offline by sp-pdb-gen and mapped read only, so every server process
+ * on a machine shares the same pages.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sp-pdb.h"
+
+#define PDB_MAX_SIZE 5 // a 5x5 board still fits in the 32 bit cell masks
+
+static struct pdb databases[PDB_MAX_SIZE+1]; // databases[size] once mapped
+static atomic_bool attempted[PDB_MAX_SIZE+1]; // whether the file for a size was already looked for, read without the lock
+static pthread_mutex_t loading = PTHREAD_MUTEX_INITIALIZER; // solvers on several threads may ask at once
+
+/**
+ * Fills in how the tiles of a board size are split into patterns, 6-6-3 for 4x4 and 6-6-6-6 for 5x5
+ * @param size the size of the square matrix (gameboard)
+ * @param tiles filled with the tiles of each pattern
+ * @param tile_count filled with the number of tiles in each pattern
+ * @return the number of patterns, 0 if the size has no partition
+ */
+int pdbPartition(int size, unsigned char tiles[PDB_MAX_PATTERNS][PDB_MAX_PATTERN_TILES], unsigned char *tile_count){
+    static const unsigned char four[3][6] = {{1,5,6,9,10,13}, {7,8,11,12,14,15}, {2,3,4}};
+    static const unsigned char four_count[3] = {6, 6, 3};
+    static const unsigned char five[4][6] = {{1,2,3,6,7,8}, {4,5,9,10,14,15}, {11,12,16,17,21,22}, {13,18,19,20,23,24}};
+    static const unsigned char five_count[4] = {6, 6, 6, 6};
+    memset(tiles, 0, PDB_MAX_PATTERNS*PDB_MAX_PATTERN_TILES);
+    if(size == 4){
+        for(int p = 0; p<3;p++){
+            tile_count[p] = four_count[p];
+            memcpy(tiles[p], four[p], four_count[p]);
+        }
+        return 3;
+    }
+    if(size == 5){
+        for(int p = 0; p<4;p++){
+            tile_count[p] = five_count[p];
+            memcpy(tiles[p], five[p], five_count[p]);
+        }
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * Counts the placements of a pattern's tiles on the board
+ * @param count the number of tiles in the pattern
+ * @param cells the number of cells on the board
+ * @return cells!/(cells-count)!, the number of entries in the pattern's table
+ */
+unsigned long pdbEntries(int count, int cells){
+    unsigned long entries = 1;
+    for(int i = 0; i<count;i++){
+        entries *= cells - i;
+    }
+    return entries;
+}
+
+/**
+ * Turns the cells of a pattern's tiles into a dense index of its table
+ * @param positions the cell of each tile in the pattern, all different
+ * @param count the number of tiles in the pattern
+ * @param cells the number of cells on the board
+ * @return a number below pdbEntries(count, cells)
+ */
+unsigned long pdbRank(const int *positions, int count, int cells){
+    unsigned long rank = 0;
+    unsigned int used = 0; // cells taken by the earlier tiles
+    for(int i = 0; i<count;i++){
+        int below = __builtin_popcount(used & ((1u << positions[i]) - 1)); // taken cells before this one
+        rank = rank*(cells - i) + (positions[i] - below); // digit i has cells-i possible values
+        used |= 1u << positions[i];
+    }
+    return rank;
+}
+
+/**
+ * Turns a dense index of a pattern's table back into the cells of its tiles
+ * @param rank a number below pdbEntries(count, cells)
+ * @param positions filled with the cell of each tile in the pattern
+ * @param count the number of tiles in the pattern
+ * @param cells the number of cells on the board
+ */
+void pdbUnrank(unsigned long rank, int *positions, int count, int cells){
+    int digits[PDB_MAX_PATTERN_TILES];
+    for(int i = count-1; i>=0;i--){
+        digits[i] = rank % (cells - i);
+        rank /= cells - i;
+    }
+    unsigned int used = 0;
+    for(int i = 0; i<count;i++){
+        int cell = 0;
+        for(int free_cells = -1; ; cell++){ // the digit counts the cells still free
+            if(!(used & (1u << cell)) && ++free_cells == digits[i]) break;
+        }
+        positions[i] = cell;
+        used |= 1u << cell;
+    }
+}
+
+/**
+ * Maps the pattern database file of a board size, called once per size with loading held
+ * @param size the size of the square matrix (gameboard)
+ * @return the database, or NULL if there is no valid file for the size
+ */
+static const struct pdb *mapDatabase(int size){
+    struct pdb *db = &databases[size];
+    const char *directory = getenv("SP_PDB_DIR"); // where sp-pdb-gen wrote the files
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s/pdb-%dx%d.bin", directory != NULL ? directory : ".", size, size);
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1) return NULL;
+    struct stat info;
+    if(fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(struct pdb_header)){
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0); // shared so other processes reuse the pages
+    close(fd);
+    if(map == MAP_FAILED) return NULL;
+    const struct pdb_header *header = map;
+    int cells = size*size;
+    bool valid = memcmp(header->magic, PDB_MAGIC, 4) == 0 && header->version == PDB_VERSION
+        && header->size == (unsigned int)size && header->patterns >= 1 && header->patterns <= PDB_MAX_PATTERNS;
+    for(int tile = 0; tile<PDB_MAX_CELLS;tile++){
+        db->pattern_of[tile] = -1;
+    }
+    for(unsigned int p = 0; valid && p<header->patterns;p++){
+        int count = header->tile_count[p];
+        if(count < 1 || count > PDB_MAX_PATTERN_TILES
+                || header->offsets[p] + pdbEntries(count, cells) > (unsigned long long)info.st_size){
+            valid = false;
+            break;
+        }
+        for(int i = 0; i<count;i++){
+            int tile = header->tiles[p][i];
+            if(tile < 1 || tile >= cells || db->pattern_of[tile] != -1){ // patterns must not share tiles
+                valid = false;
+                break;
+            }
+            db->pattern_of[tile] = p;
+            db->tiles[p][i] = tile;
+        }
+        db->tile_count[p] = count;
+        db->tables[p] = (const unsigned char *)map + header->offsets[p];
+    }
+    for(int tile = 1; valid && tile<cells;tile++){
+        if(db->pattern_of[tile] == -1) valid = false; // every tile must be covered
+    }
+    if(!valid){
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    db->size = size;
+    db->patterns = header->patterns;
+    db->map = map;
+    db->map_length = info.st_size;
+    return db;
+}
+
+/**
+ * Maps the pattern database of a board size the first time it is asked for
+ * @param size the size of the square matrix (gameboard)
+ * @return the database, or NULL if there is no valid file for the size
+ */
+const struct pdb *pdbLoad(int size){
+    if(size < 2 || size > PDB_MAX_SIZE) return NULL;
+    if(!atomic_load_explicit(&attempted[size], memory_order_acquire)){ // once looked for the answer never changes, so solvers skip the lock
+        pthread_mutex_lock(&loading);
+        if(!atomic_load_explicit(&attempted[size], memory_order_relaxed)){
+            mapDatabase(size);
+            atomic_store_explicit(&attempted[size], true, memory_order_release);
+        }
+        pthread_mutex_unlock(&loading);
+    }
+    return databases[size].map != NULL ? &databases[size] : NULL;
+}
+
+/**
+ * Looks up how many moves one pattern needs from the current placement of its tiles
+ * @param db the pattern database
+ * @param pattern the pattern to look up
+ * @param position position[tile] is the cell of each tile on the board
+ * @return the number of moves of the pattern's tiles needed to bring them home
+ */
+int pdbLookup(const struct pdb *db, int pattern, const unsigned char *position){
+    int positions[PDB_MAX_PATTERN_TILES];
+    for(int i = 0; i<db->tile_count[pattern];i++){
+        positions[i] = position[db->tiles[pattern][i]];
+    }
+    return db->tables[pattern][pdbRank(positions, db->tile_count[pattern], db->size*db->size)];
+}
@@ -0,0 +1,46 @@
+#ifndef SP_PDB
+#define SP_PDB
+
+#include <stddef.h>
+
+#define PDB_MAGIC "SPDB" // first bytes of every pattern database file
+#define PDB_VERSION 1
+#define PDB_MAX_PATTERNS 4 // most patterns a board is split into
+#define PDB_MAX_PATTERN_TILES 8 // most tiles in one pattern
+#define PDB_MAX_CELLS 32 // cells are tracked in 32 bit masks while ranking
+
+/**
+ * Layout of the start of a pattern database file, the tables follow at the given offsets
+ */
+struct pdb_header {
+    char magic[4]; // PDB_MAGIC
+    unsigned int version; // PDB_VERSION
+    unsigned int size; // the size of the square matrix (gameboard) the tables were built for
+    unsigned int patterns; // number of patterns, each has one table
+    unsigned char tiles[PDB_MAX_PATTERNS][PDB_MAX_PATTERN_TILES]; // tiles of each pattern
+    unsigned char tile_count[PDB_MAX_PATTERNS]; // number of tiles in each pattern
+    unsigned long long offsets[PDB_MAX_PATTERNS]; // file offset of each table, page aligned
+};
+
+/**
+ * A pattern database mapped into memory
+ */
+struct pdb {
+    int size; // the size of the square matrix (gameboard)
+    int patterns; // number of patterns
+    int tile_count[PDB_MAX_PATTERNS]; // number of tiles in each pattern
+    unsigned char tiles[PDB_MAX_PATTERNS][PDB_MAX_PATTERN_TILES]; // tiles of each pattern
+    signed char pattern_of[PDB_MAX_CELLS]; // pattern_of[tile] is the pattern holding the tile
+    const unsigned char *tables[PDB_MAX_PATTERNS]; // tables[p][rank] is the number of moves the pattern needs
+    void *map; // the whole mapped file
+    size_t map_length; // length of the mapping
+};
+
+int pdbPartition(int size, unsigned char tiles[PDB_MAX_PATTERNS][PDB_MAX_PATTERN_TILES], unsigned char *tile_count);
+unsigned long pdbEntries(int count, int cells);
+unsigned long pdbRank(const int *positions, int count, int cells);
+void pdbUnrank(unsigned long rank, int *positions, int count, int cells);
+const struct pdb *pdbLoad(int size);
+int pdbLookup(const struct pdb *db, int pattern, const unsigned char *position);
+
+#endif
@@ -13,80 +13,383 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
 #include "sp-pipe-client.h"
+#include "sp-message.h"
+#include "sp-ring.h"
 
 extern int client_to_server[2]; // Sends to server & reads from client
 extern int server_to_client[2]; // Sends to client & reads from server
+extern struct channel *channel; // Shared memory rings used instead of the pipes, NULL for pipes
 
+enum command {cmd_new, cmd_move, cmd_load, cmd_save, cmd_won, cmd_retrieve, cmd_solve, cmd_hint, cmd_solve_start, cmd_solve_poll, cmd_open, cmd_close, cmd_checkpoint, cmd_move_batch, cmd_stats, cmd_undo, cmd_redo, cmd_sync}; // enum values for the different requests
+
+#define VIEWPORT 16 // rows and columns shown of a board, larger boards are shown a window at a time
+#define SCRIPT_BATCH 4096 // moves of a script sent in one request at most
+
+FILE *script = NULL; // commands to run without prompts, NULL to play interactively
+unsigned int session_id = 0; // the game this client plays on a session server, 0 over a pipe
+struct message request; // the request being built
+struct message reply; // the last reply of the server
+int *board_cache = NULL; // the client's copy of the board, kept up to date by sync_board
+int cache_size = 0; // the size of the board in the cache
+uint64_t board_version = 0; // the version of the board in the cache, 0 for none
+
+/**
+ * Starts building a request
+ * @param cmd the type of request
+ */
+void begin_request(enum command cmd){
+    messageReset(&request);
+    messageWrite(&request, &session_id, sizeof(session_id)); // tells the server which game the request is for
+    messageWrite(&request, &cmd, sizeof(cmd));
+}
+
+/**
+ * Sends the request to the server and waits for its reply
+ */
+void exchange(){
+    bool answered = channel != NULL
+        ? ringSendFrame(&channel->to_server, &request) && ringReceiveFrame(&channel->to_client, &reply)
+        : sendFrame(client_to_server[1], &request) && receiveFrame(server_to_client[0], &reply);
+    if(!answered){
+        fprintf(stderr,"Lost the connection to the server\n");
+        exit(1);
+    }
+    uint32_t status = messageStatus(&reply);
+    if(status != 0){ // every request after it would get the same answer
+        fprintf(stderr, status == ERROR_SESSION ? "The server no longer has this game\n" : "The server doesn't know this request\n");
+        exit(1);
+    }
+}
+
+
+/**
+ * Brings the client's copy of the board up to date, the server sends only the cells that
+ * changed since the version the client has, or the whole board if that is older than it keeps
+ * @return false if memory ran out for the copy
+ */
+bool sync_board(){
+    begin_request(cmd_sync);
+    messageWrite(&request, &board_version, sizeof(board_version));
+    exchange();
+    int size, count;
+    messageRead(&reply, &board_version, sizeof(board_version));
+    messageRead(&reply, &size, sizeof(size));
+    messageRead(&reply, &count, sizeof(count)); // -1 when the whole board follows
+    if(count < 0){
+        if(size != cache_size){
+            int *cache = realloc(board_cache, sizeof(int) * size * size);
+            if(cache == NULL){
+                board_version = 0; // asks for the whole board again next time
+                return false;
+            }
+            board_cache = cache;
+            cache_size = size;
+        }
+        messageRead(&reply, board_cache, sizeof(int) * size * size);
+        return true;
+    }
+    for(int i = 0; i<count;i++){
+        int change[2]; // the cell and its tile
+        messageRead(&reply, change, sizeof(change));
+        board_cache[change[0]] = change[1];
+    }
+    return true;
+}
 
 /**
- * Traverses through the matrix and displays the entries in a user-friendly manner
+ * Traverses through the matrix and displays the entries in a user-friendly manner. A board
+ * larger than the viewport is shown a window at a time, the one around the empty slot
  * @param matrix the matrix consisting of the gameboards entries
  * @param size the size of the square matrix (gameboard)
  */
-void display(int *matrix,int size){
-    for(int i = 0; i<(size*size);i++){
-            int current_tile = matrix[i];
-            if(!current_tile == 0) // Must display an empty slot for the user in the place of 0
-                fprintf(stdout,((((i+1)%size == 0) && (i != 0)) ? "%3d\n" : "%3d"), current_tile); // to display a user friendly matrix
+void display(const int *matrix, int size){
+    int digits = 2; // of the largest tile, so the columns line up, at least two like the small boards always had
+    for(int largest = size*size-1; largest >= 100; largest /= 10) digits++;
+    int shown = size < VIEWPORT ? size : VIEWPORT; // rows and columns on screen
+    int blank = 0;
+    while(matrix[blank] != 0) blank++;
+    int top = blank/size - shown/2;
+    int left = blank%size - shown/2;
+    top = top < 0 ? 0 : top > size-shown ? size-shown : top;
+    left = left < 0 ? 0 : left > size-shown ? size-shown : left;
+    if(shown < size)
+        fprintf(stdout," Rows %d-%d and columns %d-%d of %d, around the empty slot\n", top+1, top+shown, left+1, left+shown, size);
+    char line[VIEWPORT * 12 + 1]; // a row is built first and written at once
+    for(int row = top; row<top+shown;row++){
+        int length = 0;
+        for(int column = left; column<left+shown;column++){
+            int current_tile = matrix[row*size + column];
+            if(current_tile != 0) // Must display an empty slot for the user in the place of 0
+                length += sprintf(line + length, "%*d", digits+1, current_tile);
             else
-                fprintf(stdout,((((i+1)%size == 0) && (i != 0)) ? "   \n" : "   "));
+                length += sprintf(line + length, "%*s", digits+1, "");
+        }
+        line[length++] = '\n';
+        fwrite(line, 1, length, stdout);
+    }
+    fprintf(stdout,"\n");
+}
+
+/**
+ * Asks the server whether the current board is already won and congratulates the user if so
+ */
+void check_won(){
+    begin_request(cmd_won); // sends a request to the server to check if the user has won
+    exchange();
+    bool won;
+    messageRead(&reply, &won, sizeof(won)); // reads back wether the user has won
+    if(won)
+        fprintf(stdout,"\nWinner winner Chicken Dinner.\n");
+}
+
+/**
+ * Sends moves gathered from a script in one batch request, and the rest again after one that fails
+ * @param tiles the tiles to move in order
+ * @param lines the line of the script each move came from
+ * @param count the number of moves
+ * @param requests counts the requests sent
+ */
+static void send_moves(const int *tiles, const long *lines, int count, long *requests){
+    int done = 0;
+    while(done < count){
+        int remaining = count - done;
+        bool want_blank = false;
+        begin_request(cmd_move_batch);
+        messageWrite(&request, &remaining, sizeof(remaining));
+        messageWrite(&request, &want_blank, sizeof(want_blank));
+        messageWrite(&request, tiles + done, sizeof(int) * remaining);
+        exchange();
+        (*requests)++;
+        int applied;
+        bool won;
+        messageRead(&reply, &applied, sizeof(applied));
+        messageRead(&reply, &won, sizeof(won));
+        done += applied;
+        if(won) // the server deals a new board and skips the rest, which go on that board
+            fprintf(stdout,"%ld: won\n", lines[done-1]);
+        else if(done < count){ // an illegal move is skipped like in the menu
+            fprintf(stderr,"%ld: tile %d could not be moved\n", lines[done], tiles[done]);
+            done++;
         }
-        fprintf(stdout,"\n");
     }
+}
+
+/**
+ * Runs the commands of a script without prompts, one per line with the letters of the menu.
+ * Moves on consecutive lines are sent to the server in batches, and the results that have
+ * something to say are printed on one line each after the number of the script line.
+ */
+void run_script(){
+    static int tiles[SCRIPT_BATCH];
+    static long lines[SCRIPT_BATCH];
+    int pending = 0; // moves not sent yet
+    long requests = 0;
+    long moves = 0;
+    long number = 0;
+    bool quitting = false;
+    char *line = NULL;
+    size_t capacity = 0;
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16); // nobody waits on a prompt, so the output goes out in blocks
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while(!quitting && getline(&line, &capacity, script) != -1){
+        number++;
+        char *next = line + strspn(line, " \t");
+        char command = *next++;
+        if(command == 'm'){ // any number of tiles, each moved on its own
+            char *end;
+            for(long tile = strtol(next, &end, 10); end != next; tile = strtol(next, &end, 10)){
+                tiles[pending] = tile;
+                lines[pending++] = number;
+                moves++;
+                if(pending == SCRIPT_BATCH){
+                    send_moves(tiles, lines, pending, &requests);
+                    pending = 0;
+                }
+                next = end;
+            }
+            continue;
+        }
+        if(command == '\n' || command == '\0' || command == '#') // blank lines and comments
+            continue;
+        send_moves(tiles, lines, pending, &requests); // the other commands see the board after every earlier move
+        pending = 0;
+        requests++;
+        switch(command){
+            case 'n':
+            case 'l':
+            case 's':
+            {
+                char argument[100] = {0}; // a size for new, a filename otherwise
+                sscanf(next, "%99s", argument);
+                if(command == 'n'){
+                    int size = atoi(argument);
+                    begin_request(cmd_new);
+                    messageWrite(&request, &size, sizeof(size));
+                }else{
+                    begin_request(command == 'l' ? cmd_load : cmd_save);
+                    messageWrite(&request, argument, sizeof(argument));
+                }
+                exchange();
+                bool result;
+                messageRead(&reply, &result, sizeof(result));
+                if(!result)
+                    fprintf(stderr,"%ld: %c %s failed\n", number, command, argument);
+                break;
+            }
+            case 'u':
+            case 'd':
+            {
+                begin_request(command == 'u' ? cmd_undo : cmd_redo);
+                exchange();
+                bool result[2];
+                messageRead(&reply, result, sizeof(result));
+                if(!result[0])
+                    fprintf(stderr,"%ld: nothing to %s\n", number, command == 'u' ? "undo" : "redo");
+                else if(result[1])
+                    fprintf(stdout,"%ld: won\n", number);
+                break;
+            }
+            case 'p':
+            {
+                if(!sync_board()){
+                    fprintf(stderr,"%ld: out of memory for the board\n", number);
+                    break;
+                }
+                fprintf(stdout,"%ld: board %d", number, cache_size);
+                for(int i = 0; i<cache_size*cache_size;i++){
+                    fprintf(stdout," %d", board_cache[i]);
+                }
+                fprintf(stdout,"\n");
+                break;
+            }
+            case 'v': // the won check the menu makes on new and loaded boards
+            {
+                begin_request(cmd_won);
+                exchange();
+                bool won;
+                messageRead(&reply, &won, sizeof(won));
+                fprintf(stdout,"%ld: %s\n", number, won ? "won" : "playing");
+                break;
+            }
+            case 't':
+            {
+                begin_request(cmd_hint);
+                exchange();
+                int tile;
+                messageRead(&reply, &tile, sizeof(tile));
+                fprintf(stdout,"%ld: hint %d\n", number, tile);
+                break;
+            }
+            case 'a':
+            case 'r':
+            {
+                begin_request(command == 'a' ? cmd_solve : cmd_solve_poll);
+                exchange();
+                int count;
+                messageRead(&reply, &count, sizeof(count)); // -2 while a background solve runs, -1 without a solution
+                fprintf(stdout,"%ld: solution %d", number, count);
+                for(int i = 0; i<count;i++){
+                    int tile;
+                    messageRead(&reply, &tile, sizeof(tile));
+                    fprintf(stdout," %d", tile);
+                }
+                fprintf(stdout,"\n");
+                break;
+            }
+            case 'b':
+            {
+                begin_request(cmd_solve_start);
+                int threads = 0;
+                messageWrite(&request, &threads, sizeof(threads));
+                exchange();
+                bool result[2]; // whether the solve started and whether the board is too large to search
+                messageRead(&reply, result, sizeof(result));
+                if(result[1])
+                    fprintf(stderr,"%ld: this board is too large for the solver\n", number);
+                else if(!result[0])
+                    fprintf(stderr,"%ld: this board can't be solved\n", number);
+                break;
+            }
+            case 'i':
+            {
+                begin_request(cmd_stats);
+                exchange();
+                fprintf(stdout,"%.*s", (int)messageRemaining(&reply), reply.data + reply.offset);
+                break;
+            }
+            case 'q': // the rest of the script is skipped
+                quitting = true;
+                requests--;
+                break;
+            default:
+                fprintf(stderr,"%ld: unknown command %c\n", number, command);
+                requests--;
+                break;
+        }
+    }
+    send_moves(tiles, lines, pending, &requests);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(line);
+    fflush(stdout);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr,"%ld lines, %ld moves, %ld requests in %.3f s (%.0f requests/s)\n", number, moves, requests, seconds, seconds > 0 ? requests / seconds : 0);
+}
 
 /**
  * The game loop from the client side. Handles the user interaction 
  * and the sending and retrieving of data from the server.
 */
 void init_client(){
-    enum command {cmd_new, cmd_move, cmd_load, cmd_save, cmd_won, cmd_retrieve}; // enum values for the different requests
     int loop_status = 1; // status set to true for the game loop to proceed
+    if(script != NULL){ // no menu, the script says what to do
+        run_script();
+        loop_status = 0;
+    }else
+        check_won(); // moves report wins themselves, only a fresh or loaded board needs asking
     while(loop_status){
-        enum command win_cmd = cmd_won;
-        write(client_to_server[1], &win_cmd, sizeof(win_cmd)); // sends a request to the server to check if the user has won
-        bool won;
-        read(server_to_client[0], &won, sizeof(won)); // reads back wether the user has won
-        if(won)
-            fprintf(stdout,"\nWinner winner Chicken Dinner.\n");     
-          
-        fprintf(stdout,"Menu: [h]elp [n]ew, [p]rint, [m]ove, [s]ave, [l]oad, [q]uit? ");
+        fprintf(stdout,"Menu: [h]elp [n]ew, [p]rint, [m]ove, [u]ndo, re[d]o, [w]alk, [t]ip, [a]uto-solve, [b]ackground solve, [r]esult, [i]nfo, [s]ave, [l]oad, [q]uit? ");
         char input;
-        scanf(" %c", &input);
+        if(scanf(" %c", &input) != 1) // the input ended, as if the user quit
+            input = 'q';
         switch(input){
             case 'n':
             {
-                fprintf(stdout,"Please input an integer (2-10) for the size of your gameboard!\n");
+                fprintf(stdout,"Please input an integer (2-1000) for the size of your gameboard!\n");
                 int temp_size;
                 if (1 == scanf("%d", &temp_size)) { // if the input was an int
-                    enum command cmd = cmd_new;
-                    write(client_to_server[1], &cmd, sizeof(cmd));
-                    write(client_to_server[1], &temp_size, sizeof(temp_size));
+                    begin_request(cmd_new);
+                    messageWrite(&request, &temp_size, sizeof(temp_size));
+                    exchange();
                     bool result;
-                    read(server_to_client[0], &result, sizeof(result));
+                    messageRead(&reply, &result, sizeof(result));
                     if(result){
                         fprintf(stdout,"New board Successfully created.\n");                        
+                        check_won();
                     }else{
                         fprintf(stderr,"An Error Occurred. Please try again later.\n");
                     }
                 }
                 else {
                     getchar(); // skip over the char if the user inputs a char
-                    fprintf(stderr,"Invalid gameboard size. Size must be between 2 & 10.\n");
+                    fprintf(stderr,"Invalid gameboard size. Size must be between 2 & 1000.\n");
                 }    
                 break;
             }
             case 'p': 
             {
                 fprintf(stdout,"\n Current Game Board.... \n");
-                enum command cmd = cmd_retrieve;
-                write(client_to_server[1], &cmd, sizeof(cmd));
-                int curr_size;
-                read(server_to_client[0], &curr_size, sizeof(curr_size)); // first read in the size of the current board inorder to know how large the vector will be
-                int matrix_board[(curr_size*curr_size)]; // size squared is the number of entries in the board
-                read(server_to_client[0], &matrix_board, sizeof(matrix_board)); 
-                display(matrix_board,curr_size); // method for displaying the board
+                if(!sync_board()){ // only the cells that changed since the last print come over
+                    fprintf(stderr,"An Error Occurred. Please try again later.\n");
+                    break;
+                }
+                display(board_cache, cache_size); // method for displaying the board
                 break;
             }
             case 'h':
@@ -96,6 +399,14 @@ void init_client(){
                 [n]ew:   Prompts for a size (1 integer) and restarts the game with a new gameboard of the size inputted \n\
                 [p]rint: Displays the current game state\n\
                 [m]ove:  Prompts for a tile to move and moves it if permissible \n\
+                [u]ndo:  Takes back the last move \n\
+                re[d]o:  Makes the last move taken back again \n\
+                [w]alk:  Prompts for a line of tiles and moves them in order, stopping at the first invalid one \n\
+                [t]ip:   Suggests the next tile to move \n\
+                [a]uto-solve: Lists the tile moves that win the game from the current state \n\
+                [b]ackground solve: Starts solving the current state on every core while you keep playing \n\
+                [r]esult: Shows the moves found by the background solve once it is done \n\
+                [i]nfo:  Shows how many requests of each kind the server handled and how long they took \n\
                 [s]ave:  Saves the current state of the game\n\
                 [l]oad:  Loads a previously saved game state\n\
                 [q]uit:  Quit the game\n\
@@ -105,30 +416,177 @@ void init_client(){
             case 'm':
             {
                 fprintf(stdout,"Which tile would you like to move? ");
-                enum command cmd = cmd_move;
-                write(client_to_server[1], &cmd, sizeof(cmd));
-                int tile;
+                int tile = 0;
                 scanf("%d", &tile);
-                write(client_to_server[1], &tile, sizeof(tile)); // write to the server the tile num to move
-                bool result;
-                read(server_to_client[0], &result, sizeof(result));  // read the result status of the move
-                if(result){
+                begin_request(cmd_move);
+                messageWrite(&request, &tile, sizeof(tile)); // write to the server the tile num to move
+                exchange();
+                bool result[2];
+                messageRead(&reply, result, sizeof(result));  // read the result status of the move and whether it won the game
+                if(result[0]){
                     fprintf(stdout,"Tile Successfully Moved\n");                        
+                    if(result[1])
+                        fprintf(stdout,"\nWinner winner Chicken Dinner.\n");
                 }else{
                     fprintf(stderr,"Invalid Tile move\n");
                 }
                 break;
             }
+            case 'w':
+            {
+                fprintf(stdout,"Which tiles would you like to move, in order, on one line? ");
+                char line[4096] = "";
+                bool given = fgets(line, sizeof(line), stdin) != NULL;
+                if(given && line[strspn(line, " \t")] == '\n') // the rest of the menu line was empty
+                    given = fgets(line, sizeof(line), stdin) != NULL;
+                if(!given){ // the input ended before the tiles
+                    fprintf(stderr,"No tiles were given\n");
+                    break;
+                }
+                begin_request(cmd_move_batch);
+                int count = 0;
+                bool want_blank = false;
+                messageWrite(&request, &count, sizeof(count)); // filled in once the tiles are counted
+                messageWrite(&request, &want_blank, sizeof(want_blank));
+                char *next = line;
+                char *end;
+                for(long tile = strtol(next, &end, 10); end != next; tile = strtol(next, &end, 10)){
+                    int value = tile;
+                    messageWrite(&request, &value, sizeof(value));
+                    count++;
+                    next = end;
+                }
+                memcpy(request.data + FRAME_HEADER + sizeof(session_id) + sizeof(enum command), &count, sizeof(count));
+                exchange();
+                int applied;
+                bool won;
+                messageRead(&reply, &applied, sizeof(applied));
+                messageRead(&reply, &won, sizeof(won));
+                fprintf(stdout,"%d of %d moves made\n", applied, count);
+                if(won)
+                    fprintf(stdout,"\nWinner winner Chicken Dinner.\n");
+                else if(applied < count){
+                    int tile;
+                    memcpy(&tile, request.data + request.length - sizeof(int) * (count - applied), sizeof(tile)); // the first move that failed
+                    fprintf(stderr,"Tile %d could not be moved, the moves after it were skipped\n", tile);
+                }
+                break;
+            }
+            case 'u':
+            case 'd':
+            {
+                begin_request(input == 'u' ? cmd_undo : cmd_redo);
+                exchange();
+                bool result[2];
+                messageRead(&reply, result, sizeof(result)); // whether a tile moved and whether that won the game
+                if(result[0]){
+                    fprintf(stdout, input == 'u' ? "Move taken back\n" : "Move made again\n");
+                    if(result[1])
+                        fprintf(stdout,"\nWinner winner Chicken Dinner.\n");
+                }else{
+                    fprintf(stderr, input == 'u' ? "There is no move to take back\n" : "There is no move to make again\n");
+                }
+                break;
+            }
+            case 'i':
+            {
+                begin_request(cmd_stats);
+                exchange();
+                fprintf(stdout,"%.*s", (int)messageRemaining(&reply), reply.data + reply.offset); // the server formats the table
+                break;
+            }
+            case 't':
+            {
+                begin_request(cmd_hint);
+                exchange();
+                int tile;
+                messageRead(&reply, &tile, sizeof(tile)); // the tile the server suggests moving
+                if(tile > 0)
+                    fprintf(stdout,"Try moving tile %d\n", tile);
+                else if(tile == 0)
+                    fprintf(stdout,"The board is already solved\n");
+                else
+                    fprintf(stderr,"No winning move could be found for this board\n");
+                break;
+            }
+            case 'a':
+            {
+                begin_request(cmd_solve);
+                exchange();
+                int count;
+                messageRead(&reply, &count, sizeof(count)); // the number of moves in the solution
+                if(count < 0){
+                    fprintf(stderr,"No solution could be found for this board\n");
+                    break;
+                }
+                int *moves = malloc(sizeof(int) * (count + 1)); // count can be 0
+                if(moves == NULL){
+                    fprintf(stderr,"An Error Occurred. Please try again later.\n");
+                    exit(1);
+                }
+                messageRead(&reply, moves, sizeof(int) * count);
+                fprintf(stdout,"Solution in %d moves:", count);
+                for(int i = 0; i<count;i++){
+                    fprintf(stdout," %d", moves[i]);
+                }
+                fprintf(stdout,"\n");
+                free(moves);
+                break;
+            }
+            case 'b':
+            {
+                begin_request(cmd_solve_start);
+                int threads = 0; // let the server pick the number of workers
+                messageWrite(&request, &threads, sizeof(threads));
+                exchange();
+                bool result[2]; // whether the solve started and whether the board is too large to search
+                messageRead(&reply, result, sizeof(result));
+                if(result[0])
+                    fprintf(stdout,"Solving in the background, press [r] to see the result\n");
+                else if(result[1])
+                    fprintf(stderr,"This board is too large for the solver\n");
+                else
+                    fprintf(stderr,"This board can't be solved\n");
+                break;
+            }
+            case 'r':
+            {
+                begin_request(cmd_solve_poll);
+                exchange();
+                int count;
+                messageRead(&reply, &count, sizeof(count)); // -2 while the server is still searching
+                if(count == -2){
+                    fprintf(stdout,"Still searching...\n");
+                    break;
+                }
+                if(count < 0){
+                    fprintf(stderr,"No solution is available, start a background solve with [b]\n");
+                    break;
+                }
+                int *moves = malloc(sizeof(int) * (count + 1)); // count can be 0
+                if(moves == NULL){
+                    fprintf(stderr,"An Error Occurred. Please try again later.\n");
+                    exit(1);
+                }
+                messageRead(&reply, moves, sizeof(int) * count);
+                fprintf(stdout,"Solution found in the background, %d moves from the board it started on:", count);
+                for(int i = 0; i<count;i++){
+                    fprintf(stdout," %d", moves[i]);
+                }
+                fprintf(stdout,"\n");
+                free(moves);
+                break;
+            }
             case 's':
             {
                 fprintf(stdout,"Input filename (99 characters max)\n");
                 char input_filename[100]; // the name of the file to be saved
-                enum command cmd = cmd_save;
-                write(client_to_server[1], &cmd, sizeof(cmd));
-                scanf("%s", input_filename);
-                write(client_to_server[1], &input_filename, sizeof(input_filename)); // let the server know what to name the new the file to be saved
+                scanf("%99s", input_filename);
+                begin_request(cmd_save);
+                messageWrite(&request, &input_filename, sizeof(input_filename)); // let the server know what to name the new the file to be saved
+                exchange();
                 bool result;
-                read(server_to_client[0], &result, sizeof(result));
+                messageRead(&reply, &result, sizeof(result));
                 if(result){
                     fprintf(stdout,"Progress Successfully Saved\n");                        
                 }else{
@@ -140,14 +598,15 @@ void init_client(){
             {
                 fprintf(stdout,"Input filename (99 characters max)\n");
                 char input_filename[100]; // the name of the file to be loaded
-                enum command cmd = cmd_load;
-                write(client_to_server[1], &cmd, sizeof(cmd));
-                scanf("%s", input_filename);
-                write(client_to_server[1], &input_filename, sizeof(input_filename));// let the server know what the name of the file to be loaded is
+                scanf("%99s", input_filename);
+                begin_request(cmd_load);
+                messageWrite(&request, &input_filename, sizeof(input_filename));// let the server know what the name of the file to be loaded is
+                exchange();
                 bool result;
-                read(server_to_client[0], &result, sizeof(result));
+                messageRead(&reply, &result, sizeof(result));
                 if(result){
                     fprintf(stdout,"Progress Successfully Loaded\n");                        
+                    check_won();
                 }else{
                     fprintf(stderr,"An Error Occurred with loading the file\n");
                 }
@@ -166,6 +625,12 @@ void init_client(){
             }
         }
     }
+    if(session_id != 0){ // a session server keeps the game until it is told to close it
+        begin_request(cmd_close);
+        exchange();
+    }
+    if(channel != NULL)
+        ringClose(&channel->to_server); // the server ends once the ring is closed, like a pipe at end of file
     exit(0);
 }
 
@@ -174,7 +639,33 @@ void init_client(){
  * Called in the main unit to initalize the client side of the game
  */
 void client(){
-    close(client_to_server[0]); // client won't use the read side of the server
-    close(server_to_client[1]); // client won't use the write side of server
+    if(channel == NULL){
+        close(client_to_server[0]); // client won't use the read side of the server
+        close(server_to_client[1]); // client won't use the write side of server
+    }
+    init_client();
+}
+
+/**
+ * Connects to a session server and plays a game of its own there
+ * @param path the path of the server's socket
+ */
+void join(const char *path){
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strncpy(address.sun_path, path, sizeof(address.sun_path)-1);
+    if(fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0){
+        fprintf(stderr,"Could not connect to the server at %s\n", path);
+        exit(1);
+    }
+    client_to_server[1] = fd; // the socket carries both directions
+    server_to_client[0] = fd;
+    begin_request(cmd_open); // asks the server for a game
+    exchange();
+    messageRead(&reply, &session_id, sizeof(session_id));
+    if(session_id == 0){
+        fprintf(stderr,"The server has no room for another game\n");
+        exit(1);
+    }
     init_client();
 }
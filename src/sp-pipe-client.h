@@ -1,8 +1,15 @@
 #ifndef SP_PIPE_CLIENT
 #define SP_PIPE_CLIENT
 
+#include <stdio.h>
+
+extern FILE *script; // commands to run without prompts, NULL to play interactively
+
+void check_won();
+void run_script();
 void init_client();
 void client();
-void display();
+void join(const char *path);
+void display(const int *matrix, int size);
 
 #endif
@@ -8,285 +8,617 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include "sp-pipe-server.h"
+#include "sp-solver.h"
+#include "sp-cache.h"
+#include "sp-distance.h"
+#include "sp-message.h"
+#include "sp-save.h"
+#include "sp-generator.h"
+#include "sp-ring.h"
+#include "sp-stats.h"
+#include "sp-journal.h"
+#include "sp-kernels.h"
 
 extern int client_to_server[2]; // Sends to server & reads from client
 extern int server_to_client[2]; // Sends to client & reads from server
+extern struct channel *channel; // Shared memory rings used instead of the pipes, NULL for pipes
 
 
-int **gameboard; // Original gameboard to be modified and used
+int solver_threads = 1; // Workers used by a background solve unless the client asks for a number, set by the -t flag
+int cache_megabytes = CACHE_DEFAULT_MB; // Memory given to the solved board cache, set by the -c flag
+struct generator board_generator; // Draws every new board, seeded once by main
+struct wal *wal = NULL; // Log of every change to the games, NULL unless a session server keeps a checkpoint
+unsigned int wal_session = 0; // Session the changes being made belong to, 0 to leave them out of the log
 
 /**
- * Initializes the gameboard and fills the tile slots with values
- * @param old_size the size of the old board to deallocate
+ * Allocates a game whose cells are left for the caller to fill
+ * @param size the size of the square matrix (gameboard)
+ * @return the game, NULL if the size is out of range or memory ran out
+ */
+struct game *allocate_game(int size){
+    if(size > MAX_SIZE || size < 2) return NULL;
+    struct game *game = malloc(sizeof(struct game) + 2 * (size_t)size * size * cellWidth(size)); // the cells and the tile index share one allocation
+    if(game == NULL) return NULL;
+    game->size = size;
+    game->width = cellWidth(size);
+    game->kernel = kernelFor(size); // the functions compiled for this size, if there are any
+    game->background_solve = NULL;
+    game->journal = NULL;
+    game->history = NULL;
+    return game;
+}
+
+/**
+ * Initializes a new gameboard and fills the tile slots with values, replacing the old game if there is one
+ * @param game pointer to the game, NULL if there is no game yet
  * @param size the size of the square matrix (gameboard)
  * @return whether the gameboard was initialized successfully
  */
-bool initialization(int old_size, int size){
-    if(size > 10 || size < 2){
+bool initialization(struct game **game, int size){
+    if(size > MAX_SIZE || size < 2){
         return false;     
     }else{
-    if(!(old_size == 37826)) // if it isnt the dummy number, then it's not the inital initialization
-        deallocate(old_size); // deallocate old board
-    int tile_number = (size*size)-1; // Largest tile value in a nxn gameboard
     printf("Setting up the game\n");
-    gameboard = malloc(sizeof(int*) * size); 
-    if(gameboard == NULL) return false;
-    for(int i = 0; i<size; i++){
-        gameboard[i] = malloc(sizeof(int) * size);
-        if(gameboard[i] == NULL) return false;
-    }
-    for(int i = 0; i<size;i++){
-        for(int j = 0;j<size;j++){
-            gameboard[i][j] = tile_number--; //Populates the board to allow for shuffling tiles
-        }
+    struct game *fresh = allocate_game(size);
+    if(fresh == NULL) return false;
+    shuffle_tiles(fresh); // to randomize the board
+    if(*game != NULL){ // a background solve works on its own copy of the board, so it carries over to the new game
+        fresh->background_solve = (*game)->background_solve;
+        deallocate(*game); // deallocate old board
     }
-    shuffle_tiles(size); // to randomize the board
+    *game = fresh;
+    if(wal != NULL && wal_session != 0) // the new board goes in the log whole
+        walBoard(wal, wal_session, fresh->gameboard, size);
     return true;
     }
 }
 
 /**
- * Shuffles the positions of the tiles in the gameboard
- * @param size the size of the square matrix (gameboard)
+ * Rebuilds the tile index, the empty slot position and the count of correctly placed tiles from the cells of the gameboard
+ * @param game the game
+ * @return true if every tile appears exactly once, false otherwise
  */
-void shuffle_tiles(int size){
-    srand(time(NULL));
-    for(int i = 0; i<(size*size);i++){ // Arbitrary shuffling size, O(n)
-        moveTile((rand()%(size*size)),size); // swaps a random tiles with the empty slot (second parameter is not used in the shuffling)
+bool index_tiles(struct game *game){
+    unsigned int cells = game->size * game->size;
+    unsigned char *position = game->gameboard + cells * game->width;
+    for(unsigned int i = 0; i<cells;i++){
+        cellSet(position, game->width, i, cells); // marks the tile as not seen yet, no cell has that index
     }
+    for(unsigned int i = 0; i<cells;i++){
+        unsigned int tile = cell_tile(game, i);
+        if(tile >= cells || tile_position(game, tile) != cells) // out of range or duplicated tile
+            return false;
+        cellSet(position, game->width, tile, i);
+    }
+    game->blank_position = tile_position(game, 0);
+    game->correct_tiles = 0;
+    for(unsigned int tile = 1; tile<cells;tile++){
+        if(tile_position(game, tile) == tile-1) game->correct_tiles++;
+    }
+    return true;
+}
+
+/**
+ * Shuffles the tiles of the gameboard into a random solvable board
+ * @param game the game
+ */
+void shuffle_tiles(struct game *game){
+    generateUniform(&board_generator, game->gameboard, game->size); // every solvable board is equally likely
+    index_tiles(game);
 }
 
 /**
  * Frees the memory used by the gameboard
- * @param size the size of the square matrix (gameboard)
+ * @param game the game
  */
-void deallocate(int size){
-    for(int i = 0; i<size; i++){
-        free(gameboard[i]); // frees the memory pointed to by *gameboard
-    }
-    free(gameboard); // frees the memory pointed to by gameboard
+void deallocate(struct game *game){
+    journalFree(game->journal);
+    free(game->history);
+    free(game); // frees the cells and the tile index, they share one allocation with the game
 }
 
 /**
- * Returns an encrypted version of the tile's entry location
+ * Returns the index of the tile's entry in the gameboard, the row is index/size and the column is index%size
+ * @param game the game
  * @param tile the value of the tile entry
- * @param size the size of the square matrix (gameboard)
- * @return an encoded version of the tile's location
+ * @return the index of the tile's location
  */ 
-int getTileLocation(int tile, int size){
-    int i, j; // i hat and j hat of the matrix entries
-    for(i = 0; i<size;i++){
-        for(j = 0;j<size;j++){
-            if(tile == gameboard[i][j]) // Finds the i and j coordinates of the entry
-                return ((i*10)+j); // merge the two components into a number that is decryptable
-        }
-    }
-    return -1; // avoid a warning 
+int getTileLocation(struct game *game, int tile){
+    return tile_position(game, tile);
 }
 
 /**
  * Checks whether the inputted tile move is permissible
+ * @param game the game
  * @param tile the value of the tile entry
- * @param size the size of the square matrix (gameboard)
  * @return true if the move valid and false otherwise
  */
-bool isMoveValid(int tile, int size){
-    if(tile < 1 || tile > (size*size)-1) // exceeds the lower and upper bounds of the gameboard
-        return false;
-    else{
-        int tile_slot = getTileLocation(tile, size);
-        int empty_slot = getTileLocation(0, size);
-        int row_diff = abs((tile_slot/10) - (empty_slot/10)); // the row distance between the tile and the empty slot
-        int column_diff = abs((tile_slot%10) - (empty_slot%10)); // the column distance between the tile and the empty slot
-        if(((row_diff == 1) ^ (column_diff == 1)) && row_diff < 2 && column_diff < 2) // move cannot be diagonal, either vertical or horizental. Move must also only be 1 row or 1 column away
-            return true;
-        else
-            return false;
-    }
+bool isMoveValid(struct game *game, int tile){
+    return board_kernels[game->kernel].valid(game, tile);
 }
 
 /**
  * swaps the inputted tile and empty slot entries in the gameboard
+ * @param game the game
  * @param tile the value to swap with 0
+ */
+void moveTile(struct game *game, int tile){
+    board_kernels[game->kernel].move(game, tile);
+}
+
+/**
+ * Finds how far the empty slot moves along the cells in a direction
  * @param size the size of the square matrix (gameboard)
+ * @param direction the direction
+ * @return the difference between the cell it moves to and the cell it leaves
+ */
+static int direction_offset(int size, int direction){
+    return direction == DIRECTION_UP ? -size : direction == DIRECTION_DOWN ? size : direction == DIRECTION_LEFT ? -1 : 1;
+}
+
+/**
+ * Moves a tile for the player, recording the move so it can be undone
+ * @param game the game
+ * @param tile the value to swap with 0, the move must be valid
+ * @return false if memory ran out for the journal, the tile then stays where it is
+ */
+bool makeMove(struct game *game, int tile){
+    int tile_slot = tile_position(game, tile);
+    int offset = tile_slot - (int)game->blank_position;
+    int direction = offset == -game->size ? DIRECTION_UP : offset == game->size ? DIRECTION_DOWN : offset == -1 ? DIRECTION_LEFT : DIRECTION_RIGHT;
+    if(!journalPush(&game->journal, direction)) return false; // a move undo doesn't know of would make it take back the wrong one
+    moveTile(game, tile);
+    if(game->history != NULL) historyPush(game->history, direction);
+    if(wal != NULL && wal_session != 0)
+        walMove(wal, wal_session, direction);
+    return true;
+}
+
+/**
+ * Moves the empty slot one cell, without recording the move
+ * @param game the game
+ * @param direction the direction the empty slot moves in
+ * @return false if the empty slot is at that edge of the board
+ */
+bool slideBlank(struct game *game, int direction){
+    int target = board_kernels[game->kernel].neighbour(game, direction);
+    if(target < 0) return false;
+    moveTile(game, cell_tile(game, target));
+    if(game->history != NULL) historyPush(game->history, direction);
+    if(wal != NULL && wal_session != 0)
+        walMove(wal, wal_session, direction);
+    return true;
+}
+
+/**
+ * Takes back the last move that is in effect
+ * @param game the game
+ * @return false if there is no move to take back
+ */
+bool undo(struct game *game){
+    struct journal *journal = game->journal;
+    if(journal == NULL || journal->position == 0) return false;
+    slideBlank(game, journalGet(journal, journal->position-1) ^ 1); // the empty slot goes back the way it came
+    journal->position--;
+    return true;
+}
+
+/**
+ * Makes again the last move that was taken back
+ * @param game the game
+ * @return false if there is no move to make again
  */
-void moveTile(int tile, int size){
-    int tile_slot = getTileLocation(tile, size);
-    int empty_slot = getTileLocation(0, size);
-    gameboard[tile_slot/10][tile_slot%10] = 0; // decrypts and assigns 0 as the value of the inpuuted tile entry's location
-    gameboard[empty_slot/10][empty_slot%10] = tile; // decrypts and assigns the tile's entry as the value of the 0 entry's location
+bool redo(struct game *game){
+    struct journal *journal = game->journal;
+    if(journal == NULL || journal->position == journal->length) return false;
+    slideBlank(game, journalGet(journal, journal->position));
+    journal->position++;
+    return true;
 }
 
 /**
  * Prompts the user that the game has ended
- * @param size the size of the square matrix (gameboard)
+ * @param game the game
  */
-void teardown(int size){
-    deallocate(size); // frees the memory allocated for gameboard since the game is over
+void teardown(struct game *game){
+    if(game->background_solve != NULL) solveFinish(game->background_solve); // stops the workers before the game goes away
+    deallocate(game); // frees the memory allocated for gameboard since the game is over
 }
 
 /**
- * Checks whether the current matrix is ordered correctly
- * @param size the size of the square matrix (gameboard)
+ * Checks whether the current matrix is ordered correctly, every tile in its cell with the empty slot last
+ * @param game the game
  * @return true if gameboard is in win mode, false otherwise
  */
-bool checkForWin(int size){
-    int expected_value = 1; // every board starts with 1
-    for(int i = 0; i<size;i++){
-        for(int j = 0;j<size;j++){
-            if(gameboard[i][j] != 0){ // empty slot can be anywhere so skip over it
-                if(gameboard[i][j] == expected_value) expected_value++; // if the value matches then increment to the next expected value
-                else return false;
+bool checkForWin(struct game *game){
+    return game->correct_tiles == (game->size * game->size)-1; // kept up to date by moveTile so the board is never scanned
+}
+
+/**
+ * Copies the gameboard into ints, the form the solver takes
+ * @param game the game
+ * @param board filled with the tiles of the board, row after row
+ */
+void copy_board(struct game *game, int *board){
+    for(int i = 0; i<(game->size * game->size);i++){
+        board[i] = cell_tile(game, i);
+    }
+}
+
+/**
+ * Writes games to a binary save file
+ * @param filename the name of the file
+ * @param games the games, NULL entries are kept as closed sessions
+ * @param count the number of games
+ * @param checksum filled with the checksum of the file, may be NULL
+ * @return true if the file was written
+ */
+bool writeBoards(const char *filename, struct game *const *games, unsigned int count, uint32_t *checksum){
+    size_t length = sizeof(struct save_header);
+    for(unsigned int i = 0; i<count;i++){
+        length += saveRecordBytes(games[i] == NULL ? 0 : games[i]->size);
+    }
+    unsigned char *buffer = calloc(1, length); // the whole file is built first so it goes out in one write
+    if(buffer == NULL) return false;
+    unsigned char *end = buffer + sizeof(struct save_header);
+    for(unsigned int i = 0; i<count;i++){
+        end = games[i] == NULL ? packRecord(end, NULL, 0) : packRecord(end, games[i]->gameboard, games[i]->size);
+    }
+    struct save_header header;
+    saveHeader(&header, count, saveChecksum(saveChecksumStart(count), buffer + sizeof(header), length - sizeof(header)));
+    memcpy(buffer, &header, sizeof(header));
+    if(checksum != NULL) *checksum = header.checksum;
+    bool written = saveWrite(filename, buffer, length);
+    free(buffer);
+    return written;
+}
+
+/**
+ * Reads every game of a binary save file
+ * @param filename the name of the file
+ * @param count filled with the number of games
+ * @param checksum filled with the checksum of the file, may be NULL
+ * @return the games with room for one more, NULL entries are closed sessions, or NULL if the file isn't a valid save
+ */
+struct game **readBoards(const char *filename, unsigned int *count, uint32_t *checksum){
+    struct save_file file;
+    if(!saveOpen(filename, &file)) return NULL;
+    if(checksum != NULL) *checksum = file.checksum;
+    struct game **games = calloc(file.count + 1, sizeof(struct game *));
+    for(unsigned int i = 0; games != NULL && i<file.count;i++){
+        int size = savePeek(&file);
+        if(size > 0) games[i] = allocate_game(size); // the tiles are unpacked straight into the game
+        bool valid = size >= 0 && (size == 0 || games[i] != NULL) && saveNext(&file, size > 0 ? games[i]->gameboard : NULL, &size);
+        if(!valid){ // one bad board spoils the file
+            for(unsigned int j = 0; j<=i;j++){
+                if(games[j] != NULL) deallocate(games[j]);
             }
+            free(games);
+            games = NULL;
+            break;
         }
+        if(size != 0)
+            index_tiles(games[i]); // saveNext already checked the tiles
     }
-    return true; // passed the entire loop
+    saveClose(&file);
+    if(games != NULL) *count = file.count;
+    return games;
 }
 
 /**
- * Saves the current game state in a file so the user's progress isn't lost
+ * Saves the current game state in a binary file so the user's progress isn't lost
+ * @param game the game
  * @param filename a pointer to the name of the file
- * @param size the size of the square matrix (gameboard)
  * @return true if save was a success, false otherwise
  */
-bool save(char *filename, int size){
-    FILE *fp = fopen(filename,"w");
-    if(fp == NULL) return false;
-    fprintf(fp,"%d\n", size); // so we can retrive the size of the gameboard when loading
-    for(int i = 0; i<size;i++){
-        for(int j = 0;j<size;j++){
-            int checkForError = fprintf(fp,"%d\n", gameboard[i][j]);
-            if(checkForError < 0) return false;
-        }
-    }
-    fclose(fp);
-    return true;
+bool save(struct game *game, char *filename){
+    return writeBoards(filename, &game, 1, NULL);
 }
 
 /**
- * Loads a saved game state as the current game state
+ * Reads a game saved as text by earlier versions, the size on the first line and then one tile per line
  * @param filename a pointer to the name of the file
- * @param size pointer to the size of the gameboard
- * @return true if load was a success, false otherwise
+ * @return the game, NULL if the file doesn't hold a valid board
  */
-bool load(char *filename, int *size){
+struct game *load_text(char *filename){
     FILE *fp = fopen(filename, "r");
-    if(fp  == NULL) return false;
-    int new_size;
+    if(fp  == NULL) return NULL;
+    int new_size = 0;
     fscanf(fp, "%d\n", &new_size); // first line of file is the size of the gameboard
-    initialization(*size,new_size);
+    struct game *loaded = allocate_game(new_size);
+    if(loaded == NULL){ // size in the file is out of range
+        fclose(fp);
+        return NULL;
+    }
     int current_tile_number;
-    for(int i = 0; i<new_size;i++){
-        for(int j = 0;j<new_size;j++){
-            fscanf(fp, "%d\n", &current_tile_number); // file formatted so that every line has a tile
-            gameboard[i][j] = current_tile_number;
-        }
+    for(int i = 0; i<(new_size*new_size);i++){
+        current_tile_number = -1;
+        fscanf(fp, "%d\n", &current_tile_number); // file formatted so that every line has a tile
+        cellSet(loaded->gameboard, loaded->width, i, current_tile_number < 0 || current_tile_number >= new_size*new_size ? new_size*new_size : current_tile_number); // tiles out of range fail the index below
     }
-    *size = new_size; // update the size of the gameboard
     fclose(fp);
+    if(!index_tiles(loaded)){
+        deallocate(loaded);
+        return NULL;
+    }
+    return loaded;
+}
+
+/**
+ * Loads a saved game state as the current game state, the current game is kept if the file doesn't hold a valid board
+ * @param game pointer to the game, replaced by the loaded one
+ * @param filename a pointer to the name of the file
+ * @return true if load was a success, false otherwise
+ */
+bool load(struct game **game, char *filename){
+    struct game *loaded = NULL;
+    if(isSaveFile(filename)){
+        unsigned int count = 0;
+        struct game **games = readBoards(filename, &count, NULL);
+        if(games != NULL){
+            loaded = games[0]; // a file of many boards gives its first one
+            for(unsigned int i = 1; i<count;i++){
+                if(games[i] != NULL) deallocate(games[i]);
+            }
+            free(games);
+        }
+    }else{
+        loaded = load_text(filename);
+    }
+    if(loaded == NULL) return false;
+    loaded->background_solve = (*game)->background_solve; // a background solve works on its own copy of the board
+    deallocate(*game);
+    *game = loaded;
+    if(wal != NULL && wal_session != 0)
+        walBoard(wal, wal_session, loaded->gameboard, loaded->size);
     return true;
 }
 
 /**
- * Retrieves data from the client and responds accordingly
+ * Carries out one request of the client on a game and writes the reply
+ * @param game pointer to the game, commands that start a new board replace it
+ * @param command the type of request
+ * @param request the rest of the request, read field by field
+ * @param reply filled with the reply
  */
-void init_server(){
-    int size;
-    size = 4;  // inital size of the gameboard as requested
-    initialization(37826,size); // since there is no memory to deallocate for the first initialization, we used a dummy int to let the function know there is no need to deallocate memoroy
-    int command;
-    int bytes_read;
-    while(1){ // while the client hasnt quit
-        bytes_read = read(client_to_server[0], &command, sizeof(command)); // reads in the type of request
-        if(bytes_read == 0){ // clue that the user has ended
-            teardown(size);
-            exit(0);
+void dispatch(struct game **game, int command, struct message *request, struct message *reply){
+    switch(command){
+        case 0: // client requested for a new board
+        {
+            int temp_size;
+            messageRead(request, &temp_size, sizeof(int)); // size of the new board
+            bool result = initialization(game, temp_size);
+            messageWrite(reply, &result, sizeof(result)); // the result status of the initialization
+            break;
+        }
+        case 1: // client requested to move a tile 
+        {
+            int tile;
+            messageRead(request, &tile, sizeof(int));
+            bool result[2] = {false, false}; // whether the tile moved and whether the move won the game
+            if(isMoveValid(*game, tile) && makeMove(*game, tile)){ // checks whether the move is valid before swaping the entries
+                result[0] = true;
+                if(checkForWin(*game)){ // the winning move starts a new game just like the win check does
+                    initialization(game, (*game)->size);
+                    result[1] = true;
+                }
+            }
+            messageWrite(reply, result, sizeof(result));
+            break;
+        }
+        case 2: // client requested to load progress
+        {
+            char filename[100];
+            messageRead(request, filename, sizeof(filename));
+            filename[sizeof(filename)-1] = '\0';
+            bool result = load(game, filename);
+            messageWrite(reply, &result, sizeof(result));
+            break;
+        }
+        case 3: // client requested to save progress
+        {
+            char filename[100];
+            messageRead(request, filename, sizeof(filename));
+            filename[sizeof(filename)-1] = '\0';
+            bool result = save(*game, filename);
+            messageWrite(reply, &result, sizeof(result));
+            break;
         }
-        switch(command){
-            case 0: // client requested for a new board
-            {
-                int temp_size;
-                read(client_to_server[0], &temp_size, sizeof(int)); // size of the new board
-                bool result;
-                if(initialization(size, temp_size)){
-                    size = temp_size;
-                    result = true;
-                }else
-                    result = false;
-                write(server_to_client[1], &result, sizeof(result)); // the result status of the initialization
-                break;
+        case 4: // checks whether the user has won
+        {
+            bool result;
+            if(checkForWin(*game)){
+                initialization(game, (*game)->size);
+                result = true;
             }
-            case 1: // client requested to move a tile 
-            {
+            else 
+                result = false;
+            messageWrite(reply, &result, sizeof(result));
+            break;
+        }
+        case 5: // client requested to view his current gameboard
+        {
+            int size = (*game)->size;
+            messageWrite(reply, &size, sizeof(size)); // let the client side know the size of the gameboard beforehand to prepare for the correct size
+            int *vector = messageReserve(reply, sizeof(int) * size * size); // to send the entries of the gameboard in a 1d array
+            if(vector != NULL) copy_board(*game, vector);
+            break;
+        }
+        case 6: // client requested the moves that win the game from the current board
+        {
+            int board[SOLVER_MAX_SIZE*SOLVER_MAX_SIZE];
+            int moves[SOLVER_MAX_MOVES];
+            int count = -1; // no solution was found, or the board is too large to search
+            if((*game)->size <= SOLVER_MAX_SIZE){
+                copy_board(*game, board);
+                count = solveQuick(board, (*game)->size, moves, SOLVER_MAX_MOVES);
+            }
+            messageWrite(reply, &count, sizeof(count)); // let the client know how many moves follow
+            if(count > 0)
+                messageWrite(reply, moves, sizeof(int) * count);
+            break;
+        }
+        case 7: // client requested a hint for the next move
+        {
+            int board[SOLVER_MAX_SIZE*SOLVER_MAX_SIZE];
+            int tile = -1; // 0 if already won, -1 if no move was found
+            if((*game)->size <= SOLVER_MAX_SIZE){
+                copy_board(*game, board);
+                tile = hint(board, (*game)->size);
+            }
+            messageWrite(reply, &tile, sizeof(tile));
+            break;
+        }
+        case 8: // client requested a solve that runs in the background while the game goes on
+        {
+            int threads;
+            messageRead(request, &threads, sizeof(threads)); // 0 or less picks the server's default
+            int board[SOLVER_MAX_SIZE*SOLVER_MAX_SIZE];
+            if((*game)->background_solve != NULL) solveFinish((*game)->background_solve); // only one background solve at a time
+            (*game)->background_solve = NULL;
+            bool result[2] = {false, (*game)->size > SOLVER_MAX_SIZE}; // whether the solve started and whether the board is too large to search
+            if(!result[1]){
+                copy_board(*game, board);
+                (*game)->background_solve = solveStart(board, (*game)->size, threads > 0 ? threads : solver_threads);
+            }
+            result[0] = (*game)->background_solve != NULL;
+            messageWrite(reply, result, sizeof(result));
+            break;
+        }
+        case 9: // client requested the result of the background solve
+        {
+            int moves[SOLVER_MAX_MOVES];
+            int count = -1; // no background solve was started
+            struct solve_job *job = (*game)->background_solve;
+            if(job != NULL)
+                count = solvePoll(job, moves, SOLVER_MAX_MOVES);
+            if(count != SOLVE_RUNNING && job != NULL){ // the result is only handed out once
+                solveFinish(job);
+                (*game)->background_solve = NULL;
+            }
+            messageWrite(reply, &count, sizeof(count)); // SOLVE_RUNNING while it still searches
+            if(count > 0)
+                messageWrite(reply, moves, sizeof(int) * count);
+            break;
+        }
+        case 13: // client sent many moves at once, replaying a recorded game for instance
+        {
+            int count;
+            bool want_blank; // whether the client wants the position of the empty slot afterwards
+            messageRead(request, &count, sizeof(count));
+            messageRead(request, &want_blank, sizeof(want_blank));
+            if(count < 0 || (size_t)count > messageRemaining(request) / sizeof(int)) // more moves than the request holds
+                count = messageRemaining(request) / sizeof(int);
+            int applied = 0;
+            bool won = false;
+            while(applied < count && !won){
                 int tile;
-                read(client_to_server[0], &tile, sizeof(int));
-                bool result;
-                if(isMoveValid(tile, size)){ // checks whether the move is valid before swaping the entries
-                    moveTile(tile, size);
-                    result = true;
+                messageRead(request, &tile, sizeof(tile));
+                if(!isMoveValid(*game, tile) || !makeMove(*game, tile)) // the moves after an illegal or unrecorded one are skipped
+                    break;
+                applied++;
+                if(checkForWin(*game)){ // the winning move starts a new game, so the rest of the batch is skipped
+                    initialization(game, (*game)->size);
+                    won = true;
                 }
-                else
-                    result = false;
-                write(server_to_client[1], &result, sizeof(result));
-                break;
             }
-            case 2: // client requested to load progress
-            {
-                char filename[100];
-                read(client_to_server[0], filename, sizeof(filename));
-                bool result;
-                if(load(filename, &size)) // pass in pointer to size so that it can update it
-                    result = true;
-                else 
-                    result = false;
-                write(server_to_client[1], &result, sizeof(result));
-                break;
+            messageWrite(reply, &applied, sizeof(applied));
+            messageWrite(reply, &won, sizeof(won));
+            if(want_blank){
+                int blank = (*game)->blank_position;
+                messageWrite(reply, &blank, sizeof(blank));
             }
-            case 3: // client requested to save progress
-            {
-                char filename[100];
-                read(client_to_server[0], filename, sizeof(filename));
-                bool result;
-                if(save(filename, size)) 
-                    result = true;
-                else 
-                    result = false;
-                write(server_to_client[1], &result, sizeof(result));
-                break;
+            break;
+        }
+        case 14: // client requested the request counters and latencies of the server
+        {
+            char text[4096];
+            size_t length = statsFormat(text, sizeof(text));
+            messageWrite(reply, text, length); // the table fills the rest of the reply
+            break;
+        }
+        case 15: // client requested to take back a move
+        case 16: // client requested to make a move again
+        {
+            bool result[2] = {false, false}; // whether a tile moved and whether the move won the game
+            result[0] = command == 15 ? undo(*game) : redo(*game);
+            if(result[0] && checkForWin(*game)){
+                initialization(game, (*game)->size);
+                result[1] = true;
             }
-            case 4: // checks whether the user has won
-            {
-                bool result;
-                if(checkForWin(size)){
-                    initialization(size, size);
-                    result = true;
+            messageWrite(reply, result, sizeof(result));
+            break;
+        }
+        case 17: // client requested the cells that changed since the version of the board it has
+        {
+            uint64_t version; // board number in the high half, moves in the low half, 0 for none
+            messageRead(request, &version, sizeof(version));
+            struct game *current = *game;
+            if(current->history == NULL) current->history = historyCreate(); // the first sync starts the history, it gets the whole board
+            struct history *history = current->history;
+            int size = current->size;
+            uint64_t latest = history == NULL ? 0 : (uint64_t)history->board << 32 | history->moves;
+            uint32_t behind = history == NULL ? 0 : history->moves - (uint32_t)version;
+            messageWrite(reply, &latest, sizeof(latest));
+            messageWrite(reply, &size, sizeof(size));
+            if(history != NULL && (version >> 32) == history->board && behind <= HISTORY_MOVES && (int)behind < size*size/2){ // the changes are smaller than the board
+                int count = behind + 1; // the cells the empty slot went through
+                messageWrite(reply, &count, sizeof(count));
+                int *changes = messageReserve(reply, sizeof(int) * 2 * count); // cell and tile pairs
+                int cell = current->blank_position;
+                for(int i = 0; changes != NULL && i<count;i++){
+                    changes[2*i] = cell;
+                    changes[2*i+1] = cell_tile(current, cell);
+                    if(i < count-1) // steps back along the moves, newest first
+                        cell -= direction_offset(size, historyGet(history, history->moves-1-i));
                 }
-                else 
-                    result = false;
-                write(server_to_client[1], &result, sizeof(result));
-                break;
+            }else{
+                int count = -1; // the whole board follows
+                messageWrite(reply, &count, sizeof(count));
+                int *vector = messageReserve(reply, sizeof(int) * size * size);
+                if(vector != NULL) copy_board(current, vector);
             }
-            case 5: // client requested to view his current gameboard
-            {
-                int vector[(size*size)]; // to send the entries of the gameboard in a 1d array
-                int vector_index = 0;
-                write(server_to_client[1], &size, sizeof(size)); // let the client side know the size of the gameboard beforehand to prepare for the correct size
-                for(int i = 0; i<size;i++){ // populate the 1d array with the entries
-                    for(int j = 0;j<size;j++){
-                        vector[vector_index++] = gameboard[i][j];
-                    }
-                } 
-                write(server_to_client[1], vector, sizeof(vector));
-                break;
-            }
-            default:
-                break;
+            break;
         }
+        default:
+            messageError(reply, ERROR_COMMAND);
+            break;
+    }
+}
+
+/**
+ * Retrieves data from the client and responds accordingly
+ */
+void init_server(){
+    struct game *game = NULL;
+    initialization(&game, 4);  // inital size of the gameboard as requested
+    struct message request = {0};
+    struct message reply = {0};
+    while(1){ // while the client hasnt quit
+        bool received = channel != NULL ? ringReceiveFrame(&channel->to_server, &request) : receiveFrame(client_to_server[0], &request);
+        if(!received){ // clue that the user has ended
+            teardown(game);
+            statsDump();
+            exit(0);
+        }
+        unsigned int session;
+        int command;
+        messageRead(&request, &session, sizeof(session)); // a pipe carries a single game, so the session is ignored
+        messageRead(&request, &command, sizeof(command)); // reads in the type of request
+        messageReset(&reply);
+        uint64_t start = statsClock();
+        dispatch(&game, command, &request, &reply);
+        statsRecord(command, start);
+        if(channel != NULL)
+            ringSendFrame(&channel->to_client, &reply);
+        else
+            sendFrame(server_to_client[1], &reply); // the whole reply goes out in one write
     }
 }
 
@@ -294,7 +626,12 @@ void init_server(){
  * Called in the main unit to initalize the server side of the game
  */
 void server(){
-    close(client_to_server[1]); // server won't use the write side of client
-    close(server_to_client[0]); // server won't use the read side of the client
+    if(channel == NULL){
+        close(client_to_server[1]); // server won't use the write side of client
+        close(server_to_client[0]); // server won't use the read side of the client
+    }
+    cacheInit((size_t)cache_megabytes << 20); // without it the solver simply searches every time
+    distanceInit(); // small boards are then answered from their tables from the first request
+    statsInit();
     init_server();
 }
@@ -2,17 +2,88 @@
 #define SP_PIPE_SERVER
 
 #include <stdbool.h>
-bool initialization(int old_size, int size);
-int getTileLocation(int tile, int size);
-bool isMoveValid(int tile, int size);
-void moveTile(int tile, int size);
-void teardown(int size);
-bool checkForWin(int size);
-void deallocate(int size);
-void shuffle_tiles(int size);
-bool save(char *filename, int size);
-bool load(char *filename, int *size);
+#include <stdint.h>
+#include "sp-cells.h"
+
+#define MAX_SIZE CELLS_MAX_SIZE // largest board a game can have
+
+struct message;
+
+/**
+ * The state of one game, the cells are followed by the tile index in the same allocation so a 4x4 game fits in tens of bytes.
+ * Cells and index entries take cellWidth(size) bytes each, one for boards up to 15x15
+ */
+struct game {
+    struct solve_job *background_solve; // Solve running alongside the game, NULL if there is none
+    struct journal *journal; // Moves made so far for undo and redo, NULL until the first move
+    struct history *history; // Latest moves for delta sync, NULL until a client first syncs
+    unsigned int blank_position; // Index of the cell holding the empty slot
+    unsigned int correct_tiles; // Number of tiles sitting in their winning cell, tile t belongs in cell t-1
+    unsigned short size; // the size of the square matrix (gameboard)
+    unsigned char width; // bytes per cell and per index entry
+    unsigned char kernel; // entry of board_kernels that moves its tiles, picked once for the size
+    _Alignas(uint32_t) unsigned char gameboard[]; // the cells row after row, then the index of the cell holding each tile
+};
+
+/**
+ * Reads a cell of a game
+ * @param game the game
+ * @param cell the index of the cell
+ * @return the tile in the cell, 0 for the empty slot
+ */
+static inline unsigned int cell_tile(const struct game *game, unsigned int cell){
+    return cellGet(game->gameboard, game->width, cell);
+}
+
+/**
+ * Finds the cell holding a tile of a game
+ * @param game the game
+ * @param tile the tile, 0 for the empty slot
+ * @return the index of the cell
+ */
+static inline unsigned int tile_position(const struct game *game, unsigned int tile){
+    return cellGet(game->gameboard + game->size * game->size * game->width, game->width, tile);
+}
+
+/**
+ * Puts a tile in a cell of a game and records where it is in the tile index
+ * @param game the game
+ * @param cell the index of the cell
+ * @param tile the tile, 0 for the empty slot
+ */
+static inline void place_tile(struct game *game, unsigned int cell, unsigned int tile){
+    cellSet(game->gameboard, game->width, cell, tile);
+    cellSet(game->gameboard + game->size * game->size * game->width, game->width, tile, cell);
+}
+
+extern int solver_threads;
+extern int cache_megabytes;
+extern struct generator board_generator;
+extern struct wal *wal;
+extern unsigned int wal_session;
+
+struct game *allocate_game(int size);
+bool initialization(struct game **game, int size);
+int getTileLocation(struct game *game, int tile);
+bool isMoveValid(struct game *game, int tile);
+void moveTile(struct game *game, int tile);
+bool makeMove(struct game *game, int tile);
+bool slideBlank(struct game *game, int direction);
+bool undo(struct game *game);
+bool redo(struct game *game);
+void teardown(struct game *game);
+bool checkForWin(struct game *game);
+void deallocate(struct game *game);
+bool index_tiles(struct game *game);
+void shuffle_tiles(struct game *game);
+void copy_board(struct game *game, int *board);
+bool writeBoards(const char *filename, struct game *const *games, unsigned int count, uint32_t *checksum);
+struct game **readBoards(const char *filename, unsigned int *count, uint32_t *checksum);
+bool save(struct game *game, char *filename);
+bool load(struct game **game, char *filename);
+void dispatch(struct game **game, int command, struct message *request, struct message *reply);
 void init_server();
 void server();
+void session_server(const char *path, const char *checkpoint);
 
 #endif
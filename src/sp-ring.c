@@ -0,0 +1,199 @@
+/**
+ * A @code sp-ring carries frames between a client and a server through rings in shared
+ * memory instead of pipes. A waiting side spins for a moment, which catches the reply of
+ * a quick request without any system call, and then sleeps on a futex until woken.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "sp-ring.h"
+#include "sp-message.h"
+
+#define SLEEP_NANOSECONDS 100000000L // a sleeper wakes this often to check that its peer is still alive
+
+/**
+ * Makes both rings of a channel in memory shared with the children forked later
+ * @return the channel, NULL if it couldn't be mapped
+ */
+struct channel *channelCreate(){
+    struct channel *channel = mmap(NULL, sizeof(struct channel), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(channel == MAP_FAILED) return NULL;
+    int spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? RING_SPINS : 0; // spinning on one core only delays the peer
+    channel->to_server.spins = spins;
+    channel->to_client.spins = spins;
+    return channel;
+}
+
+/**
+ * Tells the CPU the thread is spinning
+ */
+static inline void relax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Checks whether the process on the other side of a ring is still running
+ * @param peer the process, 0 if it isn't known yet
+ * @return false once it has exited
+ */
+static bool peerAlive(pid_t peer){
+    if(peer == 0 || peer == getppid()) return true; // a parent that exits leaves its children to another parent
+    pid_t result = waitpid(peer, NULL, WNOHANG);
+    if(result == 0) return true; // a child still running
+    if(result < 0 && errno == ECHILD) return kill(peer, 0) == 0; // not a child of this process
+    return false;
+}
+
+/**
+ * Waits until a counter of a ring moves on
+ * @param ring the ring
+ * @param counter the counter to watch
+ * @param seen the value it had
+ * @param sleeping the flag that asks the other side for a wake up
+ * @param peer the process that moves the counter
+ * @return false if the peer closed the ring or exited first
+ */
+static bool waitFor(struct ring *ring, _Atomic uint32_t *counter, uint32_t seen, _Atomic uint32_t *sleeping, pid_t peer){
+    for(int i = 0; i<ring->spins;i++){
+        if(atomic_load_explicit(counter, memory_order_acquire) != seen) return true;
+        relax();
+    }
+    while(1){
+        atomic_store(sleeping, 1); // the peer reads it after moving the counter, so one of the two sees the other
+        atomic_thread_fence(memory_order_seq_cst); // pairs with the fence in wake
+        if(atomic_load(counter) != seen){
+            atomic_store(sleeping, 0);
+            return true;
+        }
+        if(atomic_load(&ring->closed)){
+            atomic_store(sleeping, 0);
+            return false;
+        }
+        struct timespec timeout = {0, SLEEP_NANOSECONDS};
+        syscall(SYS_futex, counter, FUTEX_WAIT, seen, &timeout, NULL, 0); // shared futex, the peer is another process
+        atomic_store(sleeping, 0);
+        if(atomic_load_explicit(counter, memory_order_acquire) != seen) return true;
+        if(atomic_load(&ring->closed) || !peerAlive(peer)) return false;
+    }
+}
+
+/**
+ * Wakes the other side if it sleeps on a counter
+ * @param counter the counter that moved
+ * @param sleeping the flag the other side sets before sleeping
+ */
+static void wake(_Atomic uint32_t *counter, _Atomic uint32_t *sleeping){
+    atomic_thread_fence(memory_order_seq_cst); // the release store of the counter alone may pass the load below, and both sides would miss each other
+    if(atomic_load(sleeping))
+        syscall(SYS_futex, counter, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * Writes bytes into a ring, waiting for room when it is full
+ * @param ring the ring
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return false if the reader is gone
+ */
+static bool ringWrite(struct ring *ring, const char *data, size_t length){
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while(length > 0){
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        uint32_t room = RING_BYTES - (head - tail);
+        if(room == 0){
+            if(!waitFor(ring, &ring->tail, tail, &ring->writer_sleeping, ring->reader)) return false;
+            continue;
+        }
+        uint32_t start = head % RING_BYTES;
+        uint32_t chunk = length < room ? length : room;
+        if(chunk > RING_BYTES - start) chunk = RING_BYTES - start; // up to the end of the buffer, the rest wraps around
+        memcpy(ring->data + start, data, chunk);
+        data += chunk;
+        length -= chunk;
+        head += chunk;
+        if(length == 0 || chunk == room){ // publishes once the frame is in or the ring is full
+            atomic_store_explicit(&ring->head, head, memory_order_release);
+            wake(&ring->head, &ring->reader_sleeping);
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads bytes from a ring, waiting until they arrive
+ * @param ring the ring
+ * @param data filled with the bytes
+ * @param length the number of bytes
+ * @return false if the writer is gone before they all arrived
+ */
+static bool ringRead(struct ring *ring, char *data, size_t length){
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while(length > 0){
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint32_t waiting = head - tail;
+        if(waiting == 0){
+            if(!waitFor(ring, &ring->head, head, &ring->reader_sleeping, ring->writer)) return false;
+            continue;
+        }
+        uint32_t start = tail % RING_BYTES;
+        uint32_t chunk = length < waiting ? length : waiting;
+        if(chunk > RING_BYTES - start) chunk = RING_BYTES - start;
+        memcpy(data, ring->data + start, chunk);
+        data += chunk;
+        length -= chunk;
+        tail += chunk;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        wake(&ring->tail, &ring->writer_sleeping);
+    }
+    return true;
+}
+
+/**
+ * Writes a whole message as one frame into a ring
+ * @param ring the ring
+ * @param m the message, its header is filled in
+ * @return false if the reader is gone
+ */
+bool ringSendFrame(struct ring *ring, struct message *m){
+    if(messageReserve(m, 0) == NULL) return false;
+    uint32_t body = m->length - FRAME_HEADER;
+    memcpy(m->data, &body, FRAME_HEADER);
+    return ringWrite(ring, m->data, m->length);
+}
+
+/**
+ * Waits for a whole frame in a ring and puts it in a message, ready to be read from its body
+ * @param ring the ring
+ * @param m filled with the frame
+ * @return false if the writer is gone or sent a frame that is too large
+ */
+bool ringReceiveFrame(struct ring *ring, struct message *m){
+    uint32_t body;
+    if(!ringRead(ring, (char *)&body, sizeof(body)) || body > FRAME_MAX) return false;
+    messageReset(m);
+    void *data = messageReserve(m, body);
+    if(data == NULL) return false;
+    return ringRead(ring, data, body);
+}
+
+/**
+ * Tells the reader of a ring that nothing more will be written
+ * @param ring the ring
+ */
+void ringClose(struct ring *ring){
+    atomic_store(&ring->closed, 1);
+    syscall(SYS_futex, &ring->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
@@ -0,0 +1,42 @@
+#ifndef SP_RING
+#define SP_RING
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define RING_BYTES (64u << 10) // bytes each ring holds, larger frames pass through in pieces
+#define RING_SPINS 4000 // checks made before sleeping on a futex
+
+struct message;
+
+/**
+ * A single producer single consumer byte ring in shared memory. The counters only grow,
+ * their difference is the number of bytes waiting
+ */
+struct ring {
+    _Alignas(64) _Atomic uint32_t head; // bytes written so far, only the writer changes it
+    _Atomic uint32_t reader_sleeping; // whether the reader waits on head in a futex
+    _Alignas(64) _Atomic uint32_t tail; // bytes read so far, only the reader changes it
+    _Atomic uint32_t writer_sleeping; // whether the writer waits on tail in a futex
+    _Alignas(64) _Atomic uint32_t closed; // the writer is done, nothing more will come
+    pid_t writer; // process writing, 0 until it is known
+    pid_t reader; // process reading, 0 until it is known
+    int spins; // checks made before sleeping, 0 when there is a single core to share
+    _Alignas(64) char data[RING_BYTES];
+};
+
+/**
+ * The two rings a client and a server talk through
+ */
+struct channel {
+    struct ring to_server;
+    struct ring to_client;
+};
+
+struct channel *channelCreate();
+bool ringSendFrame(struct ring *ring, struct message *m);
+bool ringReceiveFrame(struct ring *ring, struct message *m);
+void ringClose(struct ring *ring);
+
+#endif
@@ -0,0 +1,291 @@
+/**
+ * A @code sp-save reads and writes the compact binary save format. Tiles are packed to
+ * the fewest bits that hold the largest one and a single file holds any number of boards,
+ * so every session of a server is checkpointed with one write and restored with one mmap.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sp-save.h"
+
+/**
+ * Finds the fewest bits that hold every tile of a board
+ * @param size the size of the square matrix (gameboard)
+ * @return the bits per tile
+ */
+static int tileBits(int size){
+    int bits = 1;
+    while((1 << bits) < size*size) bits++;
+    return bits;
+}
+
+/**
+ * Counts the bytes of packed tiles of a board
+ * @param size the size of the square matrix (gameboard)
+ * @param bits the bits per tile
+ * @return the bytes
+ */
+static size_t tileBytes(int size, int bits){
+    return ((size_t)size * size * bits + 7) / 8;
+}
+
+/**
+ * Reads the record at the start of a board
+ * @param file the save file
+ * @param record filled with the record
+ * @return the bytes the record takes, 0 if the file ends before it
+ */
+static size_t readRecord(const struct save_file *file, struct save_record *record){
+    if((size_t)(file->map + file->length - file->next) < sizeof(*record)) return 0;
+    memcpy(record, file->next, sizeof(*record));
+    return sizeof(*record);
+}
+
+/**
+ * Continues a 32 bit FNV-1a checksum over more bytes
+ * @param hash the checksum so far, SAVE_CHECKSUM_START for none
+ * @param data the bytes
+ * @param length the number of bytes
+ * @return the checksum
+ */
+uint32_t saveChecksum(uint32_t hash, const unsigned char *data, size_t length){
+    for(size_t i = 0; i<length;i++){
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Starts the checksum of a save file with its count of boards, so a damaged count is caught too
+ * @param count the number of boards in the file
+ * @return the checksum to continue over everything after the header
+ */
+uint32_t saveChecksumStart(uint32_t count){
+    return saveChecksum(SAVE_CHECKSUM_START, (const unsigned char *)&count, sizeof(count));
+}
+
+/**
+ * Counts the bytes a board takes in a save file
+ * @param size the size of the square matrix (gameboard), 0 for a closed session
+ * @return the bytes of its record and tiles
+ */
+size_t saveRecordBytes(int size){
+    return sizeof(struct save_record) + (size == 0 ? 0 : tileBytes(size, tileBits(size)));
+}
+
+/**
+ * Packs a board into a save record
+ * @param end where the record goes, saveRecordBytes(size) bytes
+ * @param cells the tiles of the board, row after row, cellWidth(size) bytes each, NULL for a closed session
+ * @param size the size of the square matrix (gameboard)
+ * @return the byte after the record
+ */
+unsigned char *packRecord(unsigned char *end, const unsigned char *cells, int size){
+    struct save_record record = {0, 0};
+    if(cells != NULL){
+        record.size = size;
+        record.bits = tileBits(size);
+    }
+    memcpy(end, &record, sizeof(record));
+    end += sizeof(record);
+    if(cells == NULL) return end;
+    int width = cellWidth(size);
+    uint64_t pending = 0; // bits not written out yet
+    int pending_bits = 0;
+    unsigned char *tiles = end;
+    for(int cell = 0; cell<size*size;cell++){
+        pending |= (uint64_t)cellGet(cells, width, cell) << pending_bits;
+        pending_bits += record.bits;
+        while(pending_bits >= 8){
+            *tiles++ = pending;
+            pending >>= 8;
+            pending_bits -= 8;
+        }
+    }
+    if(pending_bits > 0) *tiles = pending;
+    return end + tileBytes(size, record.bits);
+}
+
+/**
+ * Fills in the header of a save file
+ * @param header the header
+ * @param count the number of boards
+ * @param checksum of everything after the header
+ */
+void saveHeader(struct save_header *header, uint32_t count, uint32_t checksum){
+    memcpy(header->magic, SAVE_MAGIC, sizeof(header->magic));
+    header->version = SAVE_VERSION;
+    header->count = count;
+    header->checksum = checksum;
+}
+
+/**
+ * Flushes the directory holding a file to the disk, so a file renamed into it stays after a crash
+ * @param filename the name of the file
+ * @return true if the directory was synced
+ */
+static bool syncDirectory(const char *filename){
+    char directory[4096];
+    const char *slash = strrchr(filename, '/');
+    if(slash == NULL) snprintf(directory, sizeof(directory), ".");
+    else snprintf(directory, sizeof(directory), "%.*s", slash == filename ? 1 : (int)(slash - filename), filename);
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    if(fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+/**
+ * Writes a whole save file, which replaces the old one only once it is complete
+ * @param filename the name of the file
+ * @param data the file, header included
+ * @param length the size of the file
+ * @return true if the file was written
+ */
+bool saveWrite(const char *filename, const unsigned char *data, size_t length){
+    char temporary[4096];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", filename);
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0 && write(fd, data, length) == (ssize_t)length && fsync(fd) == 0; // on the disk before it replaces the old file
+    if(fd >= 0 && close(fd) != 0) written = false;
+    if(!written || rename(temporary, filename) != 0){ // a failed write leaves the last good file alone
+        unlink(temporary);
+        return false;
+    }
+    return syncDirectory(filename); // the rename itself survives a crash only once the directory is synced
+}
+
+/**
+ * Checks whether a file starts like a binary save
+ * @param filename the name of the file
+ * @return true if the file holds binary boards
+ */
+bool isSaveFile(const char *filename){
+    FILE *fp = fopen(filename, "rb");
+    if(fp == NULL) return false;
+    char magic[4] = {0};
+    bool binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, SAVE_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return binary;
+}
+
+/**
+ * Maps a save file and checks its header and checksum
+ * @param filename the name of the file
+ * @param file filled with the mapping, ready to read the first board
+ * @return false if the file isn't a valid save
+ */
+bool saveOpen(const char *filename, struct save_file *file){
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat status;
+    if(fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(struct save_header)){
+        close(fd);
+        return false;
+    }
+    file->length = status.st_size;
+    file->map = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(file->map == MAP_FAILED) return false;
+    madvise(file->map, file->length, MADV_SEQUENTIAL); // read once from front to back
+    struct save_header header;
+    memcpy(&header, file->map, sizeof(header));
+    bool valid = memcmp(header.magic, SAVE_MAGIC, sizeof(header.magic)) == 0 && header.version == SAVE_VERSION
+        && header.count <= (file->length - sizeof(header)) / sizeof(struct save_record); // every board takes a record
+    uint32_t checksum = saveChecksumStart(header.count);
+    for(size_t start = sizeof(header); valid && start<file->length;start += SAVE_CHECK_CHUNK){ // a chunk at a time, so a huge file is never all held at once
+        size_t length = file->length - start < SAVE_CHECK_CHUNK ? file->length - start : SAVE_CHECK_CHUNK;
+        checksum = saveChecksum(checksum, file->map + start, length);
+        size_t page = start & ~(size_t)4095;
+        madvise(file->map + page, start + length - page, MADV_DONTNEED); // read again from the page cache when the boards are
+    }
+    if(!valid || header.checksum != checksum){
+        munmap(file->map, file->length);
+        return false;
+    }
+    file->count = header.count;
+    file->checksum = header.checksum;
+    file->next = file->map + sizeof(header);
+    return true;
+}
+
+/**
+ * Finds the size of the next board of a save file without reading it, so room can be made for its cells
+ * @param file the save file
+ * @return the size of the board, 0 for a closed session, -1 if the file ends before it
+ */
+int savePeek(const struct save_file *file){
+    struct save_record record;
+    return readRecord(file, &record) == 0 ? -1 : record.size;
+}
+
+/**
+ * Unpacks the next board of a save file and checks in one pass that each tile appears once
+ * @param file the save file
+ * @param cells filled with the tiles of the board, row after row, cellWidth(size) bytes each for the size savePeek gives
+ * @param size filled with the size of the board, 0 for a closed session
+ * @return false if the file ends early or the board isn't valid
+ */
+bool saveNext(struct save_file *file, unsigned char *cells, int *size){
+    const unsigned char *end = file->map + file->length;
+    struct save_record record;
+    size_t header = readRecord(file, &record);
+    if(header == 0) return false;
+    const unsigned char *tiles = file->next + header;
+    if(record.size == 0){
+        file->next = tiles;
+        *size = 0;
+        return true;
+    }
+    if(record.size < 2 || record.size > SAVE_MAX_SIZE || record.bits != tileBits(record.size))
+        return false;
+    size_t bytes = tileBytes(record.size, record.bits);
+    if((size_t)(end - tiles) < bytes) return false;
+    file->next = tiles + bytes;
+    *size = record.size;
+    int count = record.size * record.size;
+    int width = cellWidth(record.size);
+    uint64_t small[64]; // enough for a 64x64 board, larger ones get theirs from the heap
+    size_t words = (count + 63) / 64;
+    uint64_t *seen = words <= 64 ? small : calloc(words, sizeof(uint64_t));
+    if(seen == NULL) return false;
+    if(seen == small) memset(small, 0, words * sizeof(uint64_t));
+    bool valid = true;
+    uint64_t pending = 0;
+    int pending_bits = 0;
+    uint64_t mask = (1u << record.bits) - 1;
+    for(int cell = 0; cell<count;cell++){
+        while(pending_bits < record.bits){
+            pending |= (uint64_t)*tiles++ << pending_bits;
+            pending_bits += 8;
+        }
+        int tile = pending & mask;
+        pending >>= record.bits;
+        pending_bits -= record.bits;
+        if(tile >= count || (seen[tile/64] >> (tile%64) & 1)){ // out of range or duplicated tile
+            valid = false;
+            break;
+        }
+        seen[tile/64] |= 1ull << (tile%64);
+        cellSet(cells, width, cell, tile);
+    }
+    if(seen != small) free(seen);
+    return valid;
+}
+
+/**
+ * Unmaps a save file
+ * @param file the save file
+ */
+void saveClose(struct save_file *file){
+    munmap(file->map, file->length);
+}
@@ -0,0 +1,56 @@
+#ifndef SP_SAVE
+#define SP_SAVE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-cells.h"
+
+#define SAVE_MAGIC "SPSV" // first bytes of a binary save file
+#define SAVE_VERSION 1
+#define SAVE_MAX_SIZE CELLS_MAX_SIZE // largest board a record holds
+#define SAVE_CHECKSUM_START 2166136261u // FNV-1a offset basis
+#define SAVE_CHECK_CHUNK (4u << 20) // bytes checked before their pages are handed back
+
+/**
+ * The start of a binary save file, the boards follow it
+ */
+struct save_header {
+    char magic[4]; // SAVE_MAGIC
+    uint32_t version; // SAVE_VERSION
+    uint32_t count; // number of boards, closed sessions included
+    uint32_t checksum; // of the count and everything after the header
+};
+
+/**
+ * The start of one board, its tiles follow packed to the fewest bits that hold the largest tile
+ */
+struct save_record {
+    uint16_t size; // the size of the square matrix (gameboard), 0 for a closed session
+    uint16_t bits; // bits per tile, the tiles take size*size*bits bits rounded up to bytes
+};
+
+/**
+ * A save file mapped for reading, one board at a time
+ */
+struct save_file {
+    unsigned char *map; // the whole file
+    size_t length;
+    const unsigned char *next; // record of the next board
+    uint32_t count; // number of boards
+    uint32_t checksum; // of everything after the header
+};
+
+uint32_t saveChecksum(uint32_t hash, const unsigned char *data, size_t length);
+uint32_t saveChecksumStart(uint32_t count);
+size_t saveRecordBytes(int size);
+unsigned char *packRecord(unsigned char *end, const unsigned char *cells, int size);
+int savePeek(const struct save_file *file);
+void saveHeader(struct save_header *header, uint32_t count, uint32_t checksum);
+bool saveWrite(const char *filename, const unsigned char *data, size_t length);
+bool isSaveFile(const char *filename);
+bool saveOpen(const char *filename, struct save_file *file);
+bool saveNext(struct save_file *file, unsigned char *cells, int *size);
+void saveClose(struct save_file *file);
+
+#endif
@@ -0,0 +1,479 @@
+/**
+ * A @code sp-session-server hosts many games in one process. Clients connect over a Unix
+ * domain socket and every request names the session it is for, so one epoll loop serves
+ * every connection without forking a server per game.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#define _GNU_SOURCE // for accept4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sp-pipe-server.h"
+#include "sp-cache.h"
+#include "sp-distance.h"
+#include "sp-message.h"
+#include "sp-save.h"
+#include "sp-stats.h"
+#include "sp-journal.h"
+
+#define CMD_OPEN 10 // starts a new game and replies with its session
+#define CMD_CLOSE 11 // ends the game of the session
+#define CMD_CHECKPOINT 12 // saves every session to the file named in the request
+#define CHECKPOINT_SECONDS 10 // time between the checkpoints of the -k file
+#define MAX_EVENTS 256 // events taken from epoll at once
+
+/**
+ * A client connected to the server, bytes are buffered until whole frames arrive or leave
+ */
+struct connection {
+    int fd;
+    char *input; // bytes received but not handled yet
+    size_t input_length;
+    size_t input_capacity;
+    char *output; // replies not sent yet
+    size_t output_length;
+    size_t output_capacity;
+    size_t output_sent; // bytes of output already written
+    bool waiting; // whether epoll watches for room to write
+};
+
+static struct game **sessions = NULL; // the game of every session, session id is the index plus one
+static unsigned int session_count = 0; // slots handed out so far
+static unsigned int session_capacity = 0;
+static unsigned int *free_sessions = NULL; // slots of closed sessions, reused first
+static unsigned int free_count = 0;
+static bool changed = false; // whether any game changed since the last checkpoint
+static volatile sig_atomic_t stopping = 0; // set when the server is asked to end
+static const char *checkpoint_file = NULL; // the -k file, NULL for none
+static uint32_t checksum = 0; // of the checkpoint the log follows, 0 before the first one
+
+/**
+ * Asks the event loop to end the server
+ * @param signal the signal that arrived
+ */
+static void requestStop(int signal){
+    stopping = 1;
+}
+
+/**
+ * Makes room in the session table
+ * @param needed the number of sessions it must hold
+ * @return false if memory ran out
+ */
+static bool growSessions(unsigned int needed){
+    if(needed <= session_capacity) return true;
+    unsigned int capacity = session_capacity == 0 ? 1024 : session_capacity;
+    while(capacity < needed) capacity *= 2;
+    struct game **grown = realloc(sessions, sizeof(struct game *) * capacity);
+    if(grown == NULL) return false;
+    sessions = grown;
+    unsigned int *grown_free = realloc(free_sessions, sizeof(unsigned int) * capacity);
+    if(grown_free == NULL) return false;
+    free_sessions = grown_free;
+    session_capacity = capacity;
+    return true;
+}
+
+/**
+ * Lists the slots of closed sessions again after the table was replaced
+ */
+static void rebuildFreeSessions(){
+    free_count = 0;
+    for(unsigned int i = session_count; i>0;i--){
+        if(sessions[i-1] == NULL) free_sessions[free_count++] = i-1; // closed sessions are reused lowest first
+    }
+}
+
+/**
+ * Starts a game in a new session
+ * @return the session id, 0 if memory ran out
+ */
+static unsigned int openSession(){
+    struct game *game = NULL;
+    if(!initialization(&game, 4)) // inital size of the gameboard as requested
+        return 0;
+    unsigned int slot;
+    if(free_count > 0){
+        slot = free_sessions[--free_count];
+    }else{
+        if(!growSessions(session_count + 1)){
+            deallocate(game);
+            return 0;
+        }
+        slot = session_count++;
+    }
+    sessions[slot] = game;
+    return slot + 1;
+}
+
+/**
+ * Finds the game of a session
+ * @param session the session id
+ * @return where the game is kept, NULL if the session isn't open
+ */
+static struct game **findSession(unsigned int session){
+    if(session == 0 || session > session_count || sessions[session-1] == NULL)
+        return NULL;
+    return &sessions[session-1];
+}
+
+/**
+ * Ends the game of a session
+ * @param session the session id
+ * @return false if the session wasn't open
+ */
+static bool closeSession(unsigned int session){
+    struct game **game = findSession(session);
+    if(game == NULL) return false;
+    teardown(*game);
+    *game = NULL;
+    free_sessions[free_count++] = session-1;
+    return true;
+}
+
+/**
+ * Saves every session to the checkpoint file and starts the log over after it
+ * @return false if the checkpoint or the log couldn't be written
+ */
+static bool writeCheckpoint(){
+    if(!writeBoards(checkpoint_file, sessions, session_count, &checksum) || !walReset(wal, checksum)){
+        fprintf(stderr,"Could not write the checkpoint %s\n", checkpoint_file);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Replaces every session with the ones saved in a file, session ids stay the same
+ * @param filename the name of the file
+ * @param checksum filled with the checksum of the file
+ * @return false if the file isn't a valid save, the sessions are then kept
+ */
+static bool restoreSessions(const char *filename, uint32_t *checksum){
+    unsigned int count = 0;
+    struct game **games = readBoards(filename, &count, checksum);
+    if(games == NULL) return false;
+    unsigned int *free_slots = malloc(sizeof(unsigned int) * (count + 1));
+    if(free_slots == NULL){
+        for(unsigned int i = 0; i<count;i++){
+            if(games[i] != NULL) deallocate(games[i]);
+        }
+        free(games);
+        return false;
+    }
+    for(unsigned int i = 0; i<session_count;i++){
+        if(sessions[i] != NULL) teardown(sessions[i]);
+    }
+    free(sessions);
+    free(free_sessions);
+    sessions = games;
+    free_sessions = free_slots;
+    session_count = count;
+    session_capacity = count + 1; // readBoards leaves room for one more
+    rebuildFreeSessions();
+    return true;
+}
+
+/**
+ * Replays the records of a write-ahead log on the sessions restored from its checkpoint
+ * @param records the records
+ * @param length the number of bytes of records
+ */
+static void replayLog(const unsigned char *records, size_t length){
+    const unsigned char *next = records;
+    const unsigned char *end = records + length;
+    while(end - next >= 5){ // a record cut short by the crash is dropped
+        int kind = next[0];
+        unsigned int session;
+        memcpy(&session, next + 1, sizeof(session));
+        next += 5;
+        if(kind < WAL_BOARD){ // a move
+            struct game **game = findSession(session);
+            if(game != NULL) slideBlank(*game, kind);
+            continue;
+        }
+        struct save_file view = {(unsigned char *)records, length, next, 1, 0}; // the board is a save record
+        int size = savePeek(&view);
+        struct game *board = size > 0 ? allocate_game(size) : NULL; // size 0 closed the session
+        if(size < 0 || (size > 0 && board == NULL) || !saveNext(&view, board == NULL ? NULL : board->gameboard, &size)){
+            if(board != NULL) deallocate(board);
+            break;
+        }
+        next = view.next;
+        if(session == 0 || !growSessions(session)){
+            if(board != NULL) deallocate(board);
+            continue;
+        }
+        while(session_count < session) sessions[session_count++] = NULL;
+        if(sessions[session-1] != NULL) teardown(sessions[session-1]);
+        sessions[session-1] = board;
+        if(board != NULL) index_tiles(board);
+    }
+    rebuildFreeSessions();
+}
+
+/**
+ * Appends bytes to a buffer of a connection
+ * @param buffer the buffer
+ * @param length bytes used in the buffer
+ * @param capacity bytes allocated for the buffer
+ * @param data the bytes to add
+ * @param size the number of bytes
+ * @return false if memory ran out
+ */
+static bool append(char **buffer, size_t *length, size_t *capacity, const void *data, size_t size){
+    if(*length + size > *capacity){
+        size_t grown = *capacity == 0 ? 4096 : *capacity;
+        while(grown < *length + size) grown *= 2;
+        char *bigger = realloc(*buffer, grown);
+        if(bigger == NULL) return false;
+        *buffer = bigger;
+        *capacity = grown;
+    }
+    memcpy(*buffer + *length, data, size);
+    *length += size;
+    return true;
+}
+
+/**
+ * Tells whether a command can change a game or the set of sessions, so the checkpoint must be written again
+ * @param command the type of request
+ * @return true for new, move, load, the batch of moves, undo, redo, open and close
+ */
+static bool changesGames(int command){
+    switch(command){
+        case 0: case 1: case 2: case 13: case 15: case 16: case CMD_OPEN: case CMD_CLOSE:
+            return true;
+        default: // reading the board, solving, hints and stats leave every game as it was
+            return false;
+    }
+}
+
+/**
+ * Carries out one request frame and queues its reply
+ * @param c the connection the frame came from
+ * @param body the body of the frame
+ * @param length the size of the body
+ * @return false if memory ran out
+ */
+static bool handleFrame(struct connection *c, const char *body, size_t length){
+    static struct message request = {0};
+    static struct message reply = {0};
+    messageReset(&request);
+    if(!messageWrite(&request, body, length)) return false;
+    unsigned int session;
+    int command;
+    messageRead(&request, &session, sizeof(session));
+    messageRead(&request, &command, sizeof(command));
+    messageReset(&reply);
+    uint64_t start = statsClock();
+    if(changesGames(command)) changed = true;
+    if(command == CMD_OPEN){
+        unsigned int id = openSession();
+        if(wal != NULL && id != 0)
+            walBoard(wal, id, sessions[id-1]->gameboard, sessions[id-1]->size);
+        messageWrite(&reply, &id, sizeof(id));
+    }else if(command == CMD_CLOSE){
+        bool result = closeSession(session);
+        if(wal != NULL && result)
+            walBoard(wal, session, NULL, 0);
+        messageWrite(&reply, &result, sizeof(result));
+    }else if(command == CMD_CHECKPOINT){
+        char filename[100];
+        messageRead(&request, filename, sizeof(filename));
+        filename[sizeof(filename)-1] = '\0';
+        bool result = writeBoards(filename, sessions, session_count, NULL);
+        messageWrite(&reply, &result, sizeof(result));
+    }else{
+        struct game **game = findSession(session);
+        wal_session = session; // changes to the game go in the log under its session
+        if(game != NULL)
+            dispatch(game, command, &request, &reply);
+        else
+            messageError(&reply, ERROR_SESSION);
+        wal_session = 0;
+    }
+    statsRecord(command, start);
+    if(messageReserve(&reply, 0) == NULL) return false; // a request with no answer still needs the buffer for its header
+    uint32_t reply_length = reply.length - FRAME_HEADER;
+    memcpy(reply.data, &reply_length, FRAME_HEADER);
+    return append(&c->output, &c->output_length, &c->output_capacity, reply.data, reply.length);
+}
+
+/**
+ * Writes as much of the queued replies as the socket takes
+ * @param c the connection
+ * @return false if the client is gone
+ */
+static bool flush(struct connection *c){
+    while(c->output_sent < c->output_length){
+        ssize_t n = send(c->fd, c->output + c->output_sent, c->output_length - c->output_sent, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true; // the rest waits for EPOLLOUT
+        if(n <= 0) return false;
+        c->output_sent += n;
+    }
+    c->output_length = c->output_sent = 0;
+    return true;
+}
+
+/**
+ * Reads what a client sent and handles every whole frame in it
+ * @param c the connection
+ * @return false if the client is gone or broke the protocol
+ */
+static bool receive(struct connection *c){
+    char chunk[16384];
+    bool closed = false; // the client is gone, but the frames it sent before still count
+    while(1){
+        ssize_t n = read(c->fd, chunk, sizeof(chunk));
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if(n <= 0){
+            closed = true;
+            break;
+        }
+        if(!append(&c->input, &c->input_length, &c->input_capacity, chunk, n)) return false;
+    }
+    size_t used = 0;
+    while(c->input_length - used >= FRAME_HEADER){
+        uint32_t body;
+        memcpy(&body, c->input + used, FRAME_HEADER);
+        if(body > FRAME_MAX) return false;
+        if(c->input_length - used < FRAME_HEADER + body) break; // the rest of the frame hasn't arrived
+        if(!handleFrame(c, c->input + used + FRAME_HEADER, body)) return false;
+        used += FRAME_HEADER + body;
+    }
+    memmove(c->input, c->input + used, c->input_length - used); // keeps the partial frame
+    c->input_length -= used;
+    if(wal != NULL && !walFlush(wal) && writeCheckpoint()) // the changes are logged before their replies go out, or saved whole if the log lost one
+        changed = false;
+    if(closed){
+        flush(c); // a client that only shut down its sending side still reads the replies
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Disconnects a client, its sessions stay open until they are closed
+ * @param epoll the event loop
+ * @param c the connection
+ */
+static void disconnect(int epoll, struct connection *c){
+    epoll_ctl(epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c->input);
+    free(c->output);
+    free(c);
+}
+
+/**
+ * Runs the server that hosts every game in this process until it is killed
+ * @param path the path of the socket clients connect to
+ * @param checkpoint file the sessions are restored from and saved to every few seconds, NULL for none
+ */
+void session_server(const char *path, const char *checkpoint){
+    cacheInit((size_t)cache_megabytes << 20); // shared by the solves of every session
+    distanceInit(); // mapped once for every session
+    statsInit();
+    struct sigaction stop = {.sa_handler = requestStop}; // no SA_RESTART, so epoll_wait returns to notice it
+    sigaction(SIGINT, &stop, NULL);
+    sigaction(SIGTERM, &stop, NULL);
+    checkpoint_file = checkpoint;
+    if(checkpoint != NULL){
+        if(access(checkpoint, F_OK) == 0 && !restoreSessions(checkpoint, &checksum)){
+            fprintf(stderr,"%s is not a valid checkpoint\n", checkpoint);
+            exit(1);
+        }
+        char log[4096];
+        snprintf(log, sizeof(log), "%s.wal", checkpoint);
+        size_t length;
+        unsigned char *records = walRead(log, checksum, &length); // changes made after the checkpoint, before a crash
+        if(records != NULL){
+            replayLog(records, length);
+            free(records);
+        }
+        if(!writeBoards(checkpoint, sessions, session_count, &checksum) || (wal = walOpen(log, checksum)) == NULL){ // the log starts over from a fresh checkpoint
+            fprintf(stderr,"Could not write the checkpoint %s\n", checkpoint);
+            exit(1);
+        }
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strncpy(address.sun_path, path, sizeof(address.sun_path)-1);
+    unlink(path); // a socket left behind by an earlier server
+    if(listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0){
+        fprintf(stderr,"Could not listen at %s\n", path);
+        exit(1);
+    }
+    int epoll = epoll_create1(0);
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL}; // NULL marks the listener
+    if(epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) < 0){
+        fprintf(stderr,"Oops.. An error occurred. Please try again later.\n");
+        exit(1);
+    }
+    printf("Serving games at %s\n", path);
+    struct epoll_event events[MAX_EVENTS];
+    time_t last_checkpoint = time(NULL);
+    while(1){
+        int ready = epoll_wait(epoll, events, MAX_EVENTS, checkpoint == NULL ? -1 : CHECKPOINT_SECONDS * 1000);
+        if(stopping){ // the games are saved and the counters written before the server ends
+            if(checkpoint != NULL) writeCheckpoint();
+            statsDump();
+            unlink(path);
+            exit(0);
+        }
+        if(ready < 0 && errno == EINTR) continue;
+        if(checkpoint != NULL && changed && time(NULL) >= last_checkpoint + CHECKPOINT_SECONDS){
+            if(writeCheckpoint()) // the log only holds what came after
+                changed = false;
+            last_checkpoint = time(NULL);
+        }
+        for(int i = 0; i<ready;i++){
+            struct connection *c = events[i].data.ptr;
+            if(c == NULL){ // new clients
+                int fd;
+                while((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK)) >= 0){
+                    c = calloc(1, sizeof(struct connection));
+                    if(c == NULL){
+                        close(fd);
+                        continue;
+                    }
+                    c->fd = fd;
+                    struct epoll_event added = {.events = EPOLLIN, .data.ptr = c};
+                    if(epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &added) < 0){
+                        close(fd);
+                        free(c);
+                    }
+                }
+                continue;
+            }
+            bool alive = true;
+            if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                alive = receive(c);
+            if(alive)
+                alive = flush(c);
+            if(!alive){
+                disconnect(epoll, c);
+                continue;
+            }
+            if(c->waiting != (c->output_length > 0)){ // waits for room only while replies are queued
+                c->waiting = c->output_length > 0;
+                struct epoll_event changed = {.events = EPOLLIN | (c->waiting ? EPOLLOUT : 0), .data.ptr = c};
+                epoll_ctl(epoll, EPOLL_CTL_MOD, c->fd, &changed);
+            }
+        }
+    }
+}
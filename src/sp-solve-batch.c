@@ -0,0 +1,298 @@
+/**
+ * A @code sp-solve-batch solves every board of a save file offline and prints one CSV line per
+ * board, in the order of the file. A reader thread unpacks the boards into a fixed window of
+ * slots, the workers claim them with an atomic counter and each solve keeps its own search
+ * state, and the main thread prints the slots in order as they finish. No lock is shared:
+ * threads wait on the counters, spinning for a moment and then sleeping on a futex. The window
+ * bounds how far the reader may run ahead of the output, so memory stays the same however
+ * many boards the file holds.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "sp-save.h"
+#include "sp-solver.h"
+#include "sp-distance.h"
+
+#define BATCH_WINDOW 1024 // boards read ahead of the output by default
+#define BATCH_SPINS 4000 // checks made before sleeping on a futex
+#define BATCH_RELEASE (4u << 20) // bytes of the file read before its pages are handed back, a power of two
+#define MAX_CELLS (SOLVER_MAX_SIZE*SOLVER_MAX_SIZE)
+
+/**
+ * One board on its way through the pipeline, slot i % window holds board i
+ */
+struct slot {
+    _Alignas(64) _Atomic uint32_t done; // i+1 once board i is solved, the main thread waits on it
+    int size; // the size of the square matrix (gameboard), 0 for a closed session
+    int moves; // moves of the solution, -1 if there is none
+    long microseconds; // time the solve took
+    int board[MAX_CELLS]; // the tiles of the board, row after row
+};
+
+/**
+ * A counter one side advances and the other waits on. Sleepers wait on changes, which moves on
+ * every wake up even when value doesn't, and the side advancing it only makes a system call when
+ * someone sleeps
+ */
+struct counter {
+    _Alignas(64) _Atomic uint32_t value;
+    _Atomic uint32_t changes; // the futex word
+    _Atomic uint32_t sleeping; // threads asleep on changes
+};
+
+static struct slot *slots; // the window
+static uint32_t window; // number of slots
+static struct counter boards_read; // boards the reader has put in the window
+static _Atomic uint32_t boards_claimed; // boards the workers have taken, never waited on
+static struct counter boards_written; // boards the main thread has printed and whose slots are free again
+static atomic_bool reader_done; // boards_read holds its final value
+static struct counter slots_done; // woken whenever a slot is done, so the main thread has one word to sleep on
+static int weight = 1; // weight passed to the solver, 1 finds the shortest solutions
+static int spins; // checks made before sleeping, 0 when there is a single core to share
+static struct save_file file;
+
+/**
+ * Tells the CPU the thread is spinning
+ */
+static inline void relax(){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Sleeps until woken or until a word no longer holds a value
+ * @param word the word
+ * @param value the value the word held when the caller last looked
+ */
+static void futexWait(_Atomic uint32_t *word, uint32_t value){
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+/**
+ * Waits until a condition on a counter holds, the condition reads value itself
+ * @param c the counter whose changes may make the condition hold
+ * @param ready the condition
+ * @param arg passed to the condition
+ */
+static void waitFor(struct counter *c, bool (*ready)(uint32_t arg), uint32_t arg){
+    for(int i = 0; i<spins;i++){
+        if(ready(arg)) return;
+        relax();
+    }
+    while(!ready(arg)){
+        uint32_t seen = atomic_load(&c->changes);
+        atomic_fetch_add(&c->sleeping, 1);
+        if(!ready(arg)) futexWait(&c->changes, seen); // a wake up between the two checks makes the futex return at once
+        atomic_fetch_sub(&c->sleeping, 1);
+    }
+}
+
+/**
+ * Wakes whoever waits on a counter, after the caller made their condition hold
+ * @param c the counter
+ */
+static void notify(struct counter *c){
+    atomic_fetch_add(&c->changes, 1);
+    if(atomic_load(&c->sleeping) > 0)
+        syscall(SYS_futex, &c->changes, FUTEX_WAKE_PRIVATE, __INT_MAX__, NULL, NULL, 0);
+}
+
+/**
+ * Advances a counter and wakes whoever waits on it
+ * @param c the counter
+ * @param value the new value
+ */
+static void advance(struct counter *c, uint32_t value){
+    atomic_store(&c->value, value);
+    notify(c);
+}
+
+/**
+ * Whether the slot of a board is free for the reader to fill
+ * @param board the index of the board
+ */
+static bool slotFree(uint32_t board){
+    return board - atomic_load_explicit(&boards_written.value, memory_order_acquire) < window;
+}
+
+/**
+ * Whether a worker can take a board, or knows there will never be one
+ * @param board the index of the board
+ */
+static bool boardReady(uint32_t board){
+    return board < atomic_load_explicit(&boards_read.value, memory_order_acquire) || atomic_load(&reader_done);
+}
+
+/**
+ * Whether a board is solved, or the reader stopped before it
+ * @param board the index of the board
+ */
+static bool boardDone(uint32_t board){
+    if(atomic_load_explicit(&slots[board % window].done, memory_order_acquire) == board+1) return true;
+    return atomic_load(&reader_done) && board >= atomic_load(&boards_read.value);
+}
+
+/**
+ * Unpacks the boards of the file into the window one at a time, handing the pages already read
+ * back to the kernel as it goes
+ * @param arg unused
+ * @return NULL
+ */
+static void *reader(void *arg){
+    unsigned char cells[MAX_CELLS];
+    size_t released = 0; // bytes at the start of the file already handed back
+    for(uint32_t board = 0; board<file.count;board++){
+        int size = savePeek(&file);
+        if(size < 0) break;
+        waitFor(&boards_written, slotFree, board);
+        struct slot *slot = &slots[board % window];
+        if(size <= SOLVER_MAX_SIZE){
+            if(!saveNext(&file, cells, &size)){
+                fprintf(stderr, "Board %u is not valid\n", board);
+                break;
+            }
+            for(int i = 0; i<size*size;i++){
+                slot->board[i] = cells[i]; // a byte per cell up to 15x15
+            }
+        }
+        else{
+            unsigned char *large = malloc((size_t)size*size*cellWidth(size) + 1);
+            bool valid = large != NULL && saveNext(&file, large, &size);
+            free(large);
+            if(!valid){
+                fprintf(stderr, "Board %u is not valid\n", board);
+                break;
+            }
+        }
+        slot->size = size;
+        size_t offset = (file.next - file.map) & ~(size_t)(BATCH_RELEASE-1);
+        if(offset > released){
+            madvise(file.map + released, offset - released, MADV_DONTNEED); // read once, so drop them from the process
+            released = offset;
+        }
+        advance(&boards_read, board+1);
+    }
+    atomic_store(&reader_done, true);
+    notify(&boards_read); // wakes the workers waiting past the end
+    notify(&slots_done); // and the main thread
+    return NULL;
+}
+
+/**
+ * Claims boards until there are none left and solves each in its slot
+ * @param arg unused
+ * @return NULL
+ */
+static void *worker(void *arg){
+    int moves[SOLVER_MAX_MOVES]; // this thread's own, the solver keeps the rest of its state per call
+    for(;;){
+        uint32_t board = atomic_fetch_add_explicit(&boards_claimed, 1, memory_order_relaxed);
+        waitFor(&boards_read, boardReady, board);
+        if(board >= atomic_load_explicit(&boards_read.value, memory_order_acquire)) break; // the reader is done and this board doesn't exist
+        struct slot *slot = &slots[board % window];
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        slot->moves = -1;
+        if(slot->size >= 2 && slot->size <= SOLVER_MAX_SIZE)
+            slot->moves = solve(slot->board, slot->size, weight, moves, SOLVER_MAX_MOVES);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        slot->microseconds = (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000;
+        atomic_store_explicit(&slot->done, board+1, memory_order_release);
+        notify(&slots_done);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv){
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    window = BATCH_WINDOW;
+    int option;
+    while((option = getopt(argc, argv, "t:w:q:")) != -1){
+        switch(option){
+            case 't': // number of workers, one per core by default
+                threads = atoi(optarg);
+                break;
+            case 'w': // heuristic weight, above 1 trades optimal lengths for speed
+                weight = atoi(optarg);
+                break;
+            case 'q': // boards read ahead of the output
+                window = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc; // falls through to the usage below
+                break;
+        }
+    }
+    if(argc - optind != 1 || threads < 1 || weight < 1 || window < 1){
+        fprintf(stderr, "usage: %s [-t threads] [-w weight] [-q window] file\n", argv[0]);
+        return 1;
+    }
+    if(!saveOpen(argv[optind], &file)){
+        fprintf(stderr, "Could not read %s\n", argv[optind]);
+        return 1;
+    }
+    if(window < (uint32_t)threads) window = threads; // every worker can hold a board
+    slots = aligned_alloc(64, window * sizeof(struct slot));
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    if(slots == NULL || workers == NULL){
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for(uint32_t i = 0; i<window;i++){
+        atomic_init(&slots[i].done, 0);
+    }
+    spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? BATCH_SPINS : 0; // spinning on one core only delays the others
+    distanceInit(); // mapped before the workers start so none of them waits on another
+    pthread_t read_thread;
+    if(pthread_create(&read_thread, NULL, reader, NULL) != 0){
+        fprintf(stderr, "Could not start the reader\n");
+        return 1;
+    }
+    int started = 0;
+    while(started < threads && pthread_create(&workers[started], NULL, worker, NULL) == 0){
+        started++;
+    }
+    if(started == 0){
+        fprintf(stderr, "Could not start the workers\n");
+        return 1;
+    }
+    printf("board,size,moves,microseconds\n");
+    uint32_t board = 0;
+    for(;; board++){
+        waitFor(&slots_done, boardDone, board);
+        if(atomic_load_explicit(&slots[board % window].done, memory_order_acquire) != board+1) break; // past the last board
+        struct slot *slot = &slots[board % window];
+        if(slot->size != 0) // closed sessions have no board to solve
+            printf("%u,%d,%d,%ld\n", board, slot->size, slot->moves, slot->microseconds);
+        advance(&boards_written, board+1);
+    }
+    pthread_join(read_thread, NULL);
+    for(int i = 0; i<started;i++){
+        pthread_join(workers[i], NULL);
+    }
+    bool complete = board == file.count;
+    saveClose(&file);
+    free(workers);
+    free(slots);
+    if(!complete){
+        fprintf(stderr, "Stopped after %u of %u boards\n", board, file.count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,926 @@
+/**
+ * A @code sp-solver finds move sequences that win the game n puzzle. It runs an
+ * iterative deepening A* search guided by the manhattan distance plus linear conflicts,
+ * or by the pattern databases when a file for the board size exists, so the memory it
+ * uses only grows with the depth of the search. Boards small enough to have a distance
+ * table are not searched at all.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "sp-solver.h"
+#include "sp-pdb.h"
+#include "sp-distance.h"
+#include "sp-packed.h"
+#include "sp-cache.h"
+
+#define NOT_FOUND -1 // the bound was exceeded everywhere under the node
+#define ABORTED -2 // the node limit or the move limit was reached
+
+#define MAX_CELLS (SOLVER_MAX_SIZE*SOLVER_MAX_SIZE)
+#define FRONTIER_MAX_DEPTH 16 // deepest level the parallel search splits the tree at
+#define FRONTIER_PER_THREAD 64 // subtrees handed to each worker so stealing can even out the load
+
+/**
+ * The state of one search, kept together so several searches can run side by side
+ */
+struct solver {
+    int size; // the size of the square matrix (gameboard)
+    int cells; // size*size
+    int weight; // the heuristic is multiplied by this, 1 keeps the solutions optimal
+    unsigned char board[MAX_CELLS]; // the tiles of the board being searched, row after row
+    unsigned char distance[MAX_CELLS][MAX_CELLS]; // distance[tile][cell] is the manhattan distance of the tile from its winning cell
+    unsigned char row_conflicts[SOLVER_MAX_SIZE]; // tiles to pull out of each row so the rest are in order
+    unsigned char column_conflicts[SOLVER_MAX_SIZE]; // tiles to pull out of each column so the rest are in order
+    unsigned char position[MAX_CELLS]; // position[tile] is the cell holding the tile
+    const struct pdb *db; // pattern databases of the board size, NULL to use the linear conflicts
+    unsigned char pattern_moves[PDB_MAX_PATTERNS]; // moves each pattern still needs
+    int patterns_total; // sum of pattern_moves
+    int blank; // index of the empty slot
+    int manhattan; // sum of the manhattan distances of every tile
+    int conflicts; // sum of the row and column conflicts
+    int next_bound; // smallest estimate that went over the current bound
+    long nodes; // nodes expanded so far
+    long node_limit; // nodes expanded before the search gives up
+    atomic_long *budget; // nodes a background job's workers still share, drawn from a chunk at a time, NULL if there is none
+    atomic_bool *stop; // set by another thread to end the search early, NULL if it can't be
+    int path[SOLVER_MAX_MOVES]; // tiles moved to reach the current node
+};
+
+/**
+ * Checks whether the board can be brought back to the winning order by legal moves
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @return true if the board is solvable, false otherwise
+ */
+bool isSolvable(const int *board, int size){
+    int cells = size*size;
+    bool visited[cells];
+    int cycles = 0;
+    int blank = 0;
+    for(int i = 0; i<cells;i++){
+        visited[i] = false;
+        if(board[i] == 0) blank = i;
+    }
+    for(int i = 0; i<cells;i++){ // every move swaps two cells, so the permutation parity flips with each move
+        if(visited[i]) continue;
+        cycles++;
+        for(int j = i; !visited[j]; j = (board[j] == 0) ? cells-1 : board[j]-1){
+            visited[j] = true;
+        }
+    }
+    int permutation_parity = (cells - cycles) % 2;
+    int blank_parity = ((size-1 - blank/size) + (size-1 - blank%size)) % 2; // every move also moves the empty slot by one cell
+    return permutation_parity == blank_parity;
+}
+
+/**
+ * Picks the heuristic weight used for a board size, larger boards trade optimality for speed
+ * @param size the size of the square matrix (gameboard)
+ * @return the weight to pass to solve
+ */
+int solverWeight(int size){
+    if(size <= 3) return 1;
+    if(size == 4) return 2; // optimal 4x4 solves can take seconds even with the databases, they run in the background instead
+    if(pdbLoad(size) != NULL) return 2;
+    if(size == 5) return 3;
+    return 5;
+}
+
+/**
+ * Counts the tiles that must leave a line so the tiles that belong to it are in order
+ * @param goals the winning positions along the line of the tiles that belong to the line
+ * @param count the number of tiles that belong to the line
+ * @return the number of tiles not in the longest ordered subsequence
+ */
+static int lineConflicts(const int *goals, int count){
+    int longest = 0;
+    int ending[SOLVER_MAX_SIZE]; // ending[i] is the longest ordered subsequence ending at tile i
+    for(int i = 0; i<count;i++){
+        ending[i] = 1;
+        for(int j = 0; j<i;j++){
+            if(goals[j] < goals[i] && ending[j]+1 > ending[i]) ending[i] = ending[j]+1;
+        }
+        if(ending[i] > longest) longest = ending[i];
+    }
+    return count - longest;
+}
+
+/**
+ * Recomputes the conflicts of one row and updates the running total
+ * @param s the search state
+ * @param row the row to recompute
+ */
+static void refreshRow(struct solver *s, int row){
+    int goals[SOLVER_MAX_SIZE];
+    int count = 0;
+    for(int column = 0; column<s->size;column++){
+        int tile = s->board[row*s->size + column];
+        if(tile != 0 && (tile-1)/s->size == row) goals[count++] = (tile-1)%s->size;
+    }
+    int conflicts = lineConflicts(goals, count);
+    s->conflicts += conflicts - s->row_conflicts[row];
+    s->row_conflicts[row] = conflicts;
+}
+
+/**
+ * Recomputes the conflicts of one column and updates the running total
+ * @param s the search state
+ * @param column the column to recompute
+ */
+static void refreshColumn(struct solver *s, int column){
+    int goals[SOLVER_MAX_SIZE];
+    int count = 0;
+    for(int row = 0; row<s->size;row++){
+        int tile = s->board[row*s->size + column];
+        if(tile != 0 && (tile-1)%s->size == column) goals[count++] = (tile-1)/s->size;
+    }
+    int conflicts = lineConflicts(goals, count);
+    s->conflicts += conflicts - s->column_conflicts[column];
+    s->column_conflicts[column] = conflicts;
+}
+
+/**
+ * Recomputes the conflicts of every line running through two cells
+ * @param s the search state
+ * @param a the first cell
+ * @param b the second cell
+ */
+static void refreshLines(struct solver *s, int a, int b){
+    int row_a = a/s->size, row_b = b/s->size;
+    int column_a = a%s->size, column_b = b%s->size;
+    refreshRow(s, row_a);
+    if(row_b != row_a) refreshRow(s, row_b);
+    refreshColumn(s, column_a);
+    if(column_b != column_a) refreshColumn(s, column_b);
+}
+
+/**
+ * Estimates the number of moves left from the current node
+ * @param s the search state
+ * @return a lower bound on the moves needed to win
+ */
+static int heuristic(const struct solver *s){
+    if(s->db != NULL) return s->patterns_total;
+    return s->manhattan + 2*s->conflicts;
+}
+
+/**
+ * Slides the tile in a cell next to the empty slot into the empty slot
+ * @param s the search state
+ * @param cell the cell of the tile to slide
+ */
+static void slide(struct solver *s, int cell){
+    int tile = s->board[cell];
+    s->manhattan += s->distance[tile][s->blank] - s->distance[tile][cell];
+    s->board[s->blank] = tile;
+    s->board[cell] = 0;
+    s->position[tile] = s->blank;
+    s->position[0] = cell;
+    if(s->db != NULL){ // only the pattern holding the tile can change
+        int pattern = s->db->pattern_of[tile];
+        int moves = pdbLookup(s->db, pattern, s->position);
+        s->patterns_total += moves - s->pattern_moves[pattern];
+        s->pattern_moves[pattern] = moves;
+    }else
+        refreshLines(s, cell, s->blank);
+    s->blank = cell;
+}
+
+/**
+ * Takes more nodes from the budget a background job's workers share
+ * @param s the search state that used up its nodes
+ * @return true if it may go on, false once the budget is spent
+ */
+static bool drawNodes(struct solver *s){
+    if(s->budget == NULL) return false;
+    long left = atomic_fetch_sub_explicit(s->budget, SOLVER_NODE_CHUNK, memory_order_relaxed);
+    if(left <= 0) return false;
+    s->node_limit += left < SOLVER_NODE_CHUNK ? left : SOLVER_NODE_CHUNK;
+    return true;
+}
+
+/**
+ * Depth first search of every node whose estimate stays within the bound
+ * @param s the search state
+ * @param depth the number of moves made to reach the current node
+ * @param bound the largest estimate allowed in this iteration
+ * @param previous the cell the empty slot came from, so the last move isn't undone
+ * @return the length of the solution, NOT_FOUND or ABORTED
+ */
+static int search(struct solver *s, int depth, int bound, int previous){
+    int estimate = depth + s->weight * heuristic(s);
+    if(estimate > bound){
+        if(estimate < s->next_bound) s->next_bound = estimate;
+        return NOT_FOUND;
+    }
+    if(s->manhattan == 0) // every tile is in its winning cell
+        return depth;
+    if(depth == SOLVER_MAX_MOVES || (++s->nodes > s->node_limit && !drawNodes(s)))
+        return ABORTED;
+    if(s->stop != NULL && atomic_load_explicit(s->stop, memory_order_relaxed))
+        return ABORTED;
+    int row = s->blank/s->size, column = s->blank%s->size;
+    int neighbours[4];
+    int count = 0;
+    if(row > 0) neighbours[count++] = s->blank - s->size;
+    if(row < s->size-1) neighbours[count++] = s->blank + s->size;
+    if(column > 0) neighbours[count++] = s->blank - 1;
+    if(column < s->size-1) neighbours[count++] = s->blank + 1;
+    for(int i = 0; i<count;i++){
+        int cell = neighbours[i];
+        if(cell == previous) continue;
+        int from = s->blank;
+        s->path[depth] = s->board[cell];
+        slide(s, cell);
+        int result = search(s, depth+1, bound, from);
+        slide(s, from); // undo the move
+        if(result != NOT_FOUND) return result;
+    }
+    return NOT_FOUND;
+}
+
+/**
+ * Sets up the search state for a board
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @param weight multiplies the heuristic, 1 keeps the solutions optimal
+ * @return the search state to free once done, or NULL if the board is unsolvable or memory ran out
+ */
+static struct solver *prepare(const int *board, int size, int weight){
+    if(size < 2 || size > SOLVER_MAX_SIZE || !isSolvable(board, size))
+        return NULL;
+    struct solver *s = calloc(1, sizeof(struct solver)); // too large for the stack of a thread
+    if(s == NULL) return NULL;
+    s->size = size;
+    s->cells = size*size;
+    s->weight = weight < 1 ? 1 : weight;
+    s->node_limit = SOLVER_NODE_LIMIT;
+    for(int tile = 1; tile<s->cells;tile++){
+        int goal = tile-1; // tile t belongs in cell t-1
+        for(int cell = 0; cell<s->cells;cell++){
+            s->distance[tile][cell] = abs(cell/size - goal/size) + abs(cell%size - goal%size);
+        }
+    }
+    for(int i = 0; i<s->cells;i++){
+        s->board[i] = board[i];
+        s->position[board[i]] = i;
+        if(board[i] == 0) s->blank = i;
+        s->manhattan += s->distance[board[i]][i];
+    }
+    s->db = pdbLoad(size);
+    if(s->db != NULL){
+        for(int p = 0; p<s->db->patterns;p++){
+            s->pattern_moves[p] = pdbLookup(s->db, p, s->position);
+            s->patterns_total += s->pattern_moves[p];
+        }
+    }else{
+        for(int i = 0; i<size;i++){
+            refreshRow(s, i);
+            refreshColumn(s, i);
+        }
+    }
+    return s;
+}
+
+/**
+ * Rebuilds a solution from the cache by following the next tile of each cached board
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @param need_optimal whether only shortest solutions may be used
+ * @param moves filled with the tiles to move, in order
+ * @param max_moves the capacity of moves
+ * @return the number of moves, or -1 if some board along the way isn't cached
+ */
+static int recallPath(const int *board, int size, bool need_optimal, int *moves, int max_moves){
+    int cells = size*size;
+    int current[MAX_CELLS];
+    int blank = 0;
+    for(int i = 0; i<cells;i++){
+        current[i] = board[i];
+        if(board[i] == 0) blank = i;
+    }
+    int expected = -1; // each step must be one move closer, which also rules out cycles
+    for(int count = 0; ; count++){
+        int distance, tile;
+        bool optimal;
+        if(!cacheLookup(cacheKey(current, size), &distance, &tile, &optimal) || (need_optimal && !optimal))
+            return -1;
+        if(expected != -1 && distance != expected) return -1;
+        if(distance == 0){
+            for(int i = 0; i<cells-1;i++){
+                if(current[i] != i+1) return -1; // a different board with the same key
+            }
+            return count;
+        }
+        if(count == max_moves) return -1;
+        int cell = -1;
+        int neighbours[4] = {blank-size, blank+size, blank%size > 0 ? blank-1 : -1, blank%size < size-1 ? blank+1 : -1};
+        for(int i = 0; i<4;i++){
+            if(neighbours[i] >= 0 && neighbours[i] < cells && current[neighbours[i]] == tile) cell = neighbours[i];
+        }
+        if(cell == -1) return -1; // the cached tile can't move, the key belonged to another board
+        current[blank] = tile;
+        current[cell] = 0;
+        blank = cell;
+        moves[count] = tile;
+        expected = distance-1;
+    }
+}
+
+/**
+ * Stores every board along a solution in the cache, so hints along the way are lookups
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @param moves the tiles to move, in order
+ * @param count the number of moves
+ * @param optimal whether the solution is a shortest one
+ */
+static void rememberPath(const int *board, int size, const int *moves, int count, bool optimal){
+    int cells = size*size;
+    int current[MAX_CELLS];
+    int blank = 0;
+    for(int i = 0; i<cells;i++){
+        current[i] = board[i];
+        if(board[i] == 0) blank = i;
+    }
+    for(int i = 0; i<=count;i++){
+        cacheStore(cacheKey(current, size), count-i, i < count ? moves[i] : 0, optimal);
+        if(i == count) break;
+        for(int cell = 0; cell<cells;cell++){
+            if(current[cell] == moves[i]){
+                current[blank] = moves[i];
+                current[cell] = 0;
+                blank = cell;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Walks a board home through its distance table, each move going to the neighbour one move closer
+ * @param table the distance table of the board size
+ * @param board the tiles of the board, row after row, solvable
+ * @param moves filled with the first max_moves tiles to move
+ * @param max_moves the capacity of moves
+ * @return the fewest moves that win the board
+ */
+static int followTable(const struct distance_table *table, const int *board, int *moves, int max_moves){
+    int size = table->size;
+    int walk[DISTANCE_MAX_SIZE*DISTANCE_MAX_SIZE];
+    int blank = 0;
+    for(int i = 0; i<size*size;i++){
+        walk[i] = board[i];
+        if(walk[i] == 0) blank = i;
+    }
+    int distance = distanceLookup(table, walk);
+    for(int step = 0; step<distance && step<max_moves;step++){
+        int neighbours[4] = {blank-size, blank+size, blank%size > 0 ? blank-1 : -1, blank%size < size-1 ? blank+1 : -1};
+        for(int d = 0; d<4;d++){
+            int cell = neighbours[d];
+            if(cell < 0 || cell >= size*size) continue;
+            walk[blank] = walk[cell];
+            walk[cell] = 0;
+            if(distanceLookup(table, walk) == distance-step-1){ // some neighbour is always one move closer
+                moves[step] = walk[blank];
+                blank = cell;
+                break;
+            }
+            walk[cell] = walk[blank];
+            walk[blank] = 0;
+        }
+    }
+    return distance;
+}
+
+/**
+ * Finds a move sequence that wins the game from the given board, from the distance table
+ * of a small board, or from the cache when every board along a solution is cached
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @param weight multiplies the heuristic, 1 finds the shortest sequence and w finds one at most w times longer
+ * @param moves filled with the tiles to move, in order
+ * @param max_moves the capacity of moves
+ * @return the number of moves, or -1 if the board is unsolvable or no sequence was found within the limits
+ */
+int solve(const int *board, int size, int weight, int *moves, int max_moves){
+    const struct distance_table *table = distanceLoad(size);
+    if(table != NULL){
+        if(!isSolvable(board, size)) return -1;
+        int count = followTable(table, board, moves, max_moves);
+        return count > max_moves ? -1 : count;
+    }
+    if(size >= 2 && size <= SOLVER_MAX_SIZE){
+        int recalled = recallPath(board, size, weight <= 1, moves, max_moves);
+        if(recalled >= 0) return recalled;
+    }
+    struct solver *s = prepare(board, size, weight);
+    if(s == NULL) return -1;
+    cacheNewGeneration();
+    int bound = s->weight * heuristic(s);
+    int result = NOT_FOUND;
+    while(result == NOT_FOUND){ // each iteration raises the bound to the smallest estimate that exceeded it
+        s->next_bound = __INT_MAX__;
+        result = search(s, 0, bound, -1);
+        bound = s->next_bound;
+    }
+    if(result > max_moves) result = ABORTED;
+    for(int i = 0; i<result;i++){
+        moves[i] = s->path[i];
+    }
+    if(result >= 0) rememberPath(board, size, moves, result, s->weight == 1);
+    free(s);
+    return result < 0 ? -1 : result;
+}
+
+/**
+ * Finds a move sequence quickly enough to answer a player, at the weight of the board size and then
+ * at ever larger weights whenever the node limit is reached, so a solvable board always gets one
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @param moves filled with the tiles to move, in order
+ * @param max_moves the capacity of moves
+ * @return the number of moves, or -1 if the board is unsolvable or no sequence was found at any weight
+ */
+int solveQuick(const int *board, int size, int *moves, int max_moves){
+    if(size < 2 || size > SOLVER_MAX_SIZE || !isSolvable(board, size)) return -1;
+    int count = -1;
+    for(int weight = solverWeight(size); count < 0 && weight<=SOLVER_MAX_WEIGHT;weight *= 2){
+        count = solve(board, size, weight, moves, max_moves);
+    }
+    return count;
+}
+
+/**
+ * Suggests the next tile to move from the given board, a few table lookups on a small
+ * board, or a single cache lookup once the board has been seen along an earlier solution
+ * @param board the tiles of the board, row after row
+ * @param size the size of the square matrix (gameboard)
+ * @return the tile to move, 0 if the board is already won, or -1 if no move could be found
+ */
+int hint(const int *board, int size){
+    if(size < 2 || size > SOLVER_MAX_SIZE) return -1;
+    const struct distance_table *table = distanceLoad(size);
+    if(table != NULL){
+        int first;
+        if(!isSolvable(board, size)) return -1;
+        return followTable(table, board, &first, 1) == 0 ? 0 : first;
+    }
+    int distance, tile;
+    bool optimal;
+    if(cacheLookup(cacheKey(board, size), &distance, &tile, &optimal)){
+        if(tile == 0) return distance == 0 ? 0 : -1;
+        int blank = 0, cell = 0;
+        for(int i = 0; i<size*size;i++){
+            if(board[i] == 0) blank = i;
+            if(board[i] == tile) cell = i;
+        }
+        if(abs(blank/size - cell/size) + abs(blank%size - cell%size) == 1) // a key shared with another board could name any tile
+            return tile;
+    }
+    int moves[SOLVER_MAX_MOVES];
+    int count = solveQuick(board, size, moves, SOLVER_MAX_MOVES);
+    if(count < 0) return -1;
+    if(count == 0) return 0;
+    return moves[0];
+}
+
+/**
+ * A share of the subtrees of one iteration, owned by one worker but open to stealing
+ */
+struct work_range {
+    atomic_int next; // next subtree to take
+    int end; // one past the last subtree of the share
+    char padding[56]; // keeps each share on its own cache line
+};
+
+/**
+ * A parallel search running in the background
+ */
+struct solve_job {
+    int threads; // workers searching the tree, the coordinator is worker 0
+    struct solver *root; // search state at the board being solved
+    int root_blank; // the empty slot of the board being solved
+    unsigned char (*frontier)[FRONTIER_MAX_DEPTH]; // cells the empty slot visits to reach each subtree
+    int frontier_count; // number of subtrees
+    int frontier_depth; // moves from the board to every subtree
+    struct work_range *ranges; // one share of the subtrees per worker
+    pthread_barrier_t barrier; // lines the workers up between iterations
+    pthread_t coordinator; // thread running the job
+    int bound; // largest estimate allowed in the current iteration
+    atomic_int next_bound; // smallest estimate any worker saw go over the bound
+    atomic_int found; // length of the first solution found, -1 while there is none
+    atomic_bool stop; // tells every worker to stop, set on a solution, a failure or a cancel
+    atomic_long budget; // nodes every worker together may still expand
+    pthread_mutex_t gate; // held while the workers start, so they only begin once their number is known
+    atomic_bool done; // the result is final
+    bool finished; // no more iterations will run
+    int result; // number of moves, or -1 if no solution was found
+    int moves[SOLVER_MAX_MOVES]; // the solution
+};
+
+/**
+ * Replays the moves leading from the board to a subtree
+ * @param s the search state, at the board being solved
+ * @param cells the cells the empty slot moves into
+ * @param count the number of moves
+ */
+static void replay(struct solver *s, const unsigned char *cells, int count){
+    for(int i = 0; i<count;i++){
+        s->path[i] = s->board[cells[i]];
+        slide(s, cells[i]);
+    }
+}
+
+/**
+ * Takes back the moves made by replay
+ * @param s the search state, at the subtree
+ * @param root_blank the empty slot of the board being solved
+ * @param cells the cells the empty slot moved into
+ * @param count the number of moves
+ */
+static void unwind(struct solver *s, int root_blank, const unsigned char *cells, int count){
+    for(int i = count-1; i>=0;i--){
+        slide(s, i > 0 ? cells[i-1] : root_blank);
+    }
+}
+
+/**
+ * Adds a packed board to an open addressed set
+ * @param set the slots of the set, 0 marks an empty slot since no board packs to 0
+ * @param mask the number of slots minus one, the number of slots is a power of two
+ * @param state the packed board
+ * @return true if the board was added, false if it was already in the set
+ */
+static bool addUnique(packed_state *set, uint64_t mask, packed_state state){
+    for(uint64_t slot = packedHash(state) & mask; ; slot = (slot+1) & mask){
+        if(set[slot] == 0){
+            set[slot] = state;
+            return true;
+        }
+        if(packedEqual(set[slot], state)) return false;
+    }
+}
+
+/**
+ * Orders the subtrees of a board that fits a packed state so each worker's share starts with the
+ * ones closest to winning, by their manhattan distances computed a batch at a time. The last
+ * iteration stops at the first solution, so it tends to come sooner
+ * @param job the job whose tree was split
+ * @param level the moves leading to each subtree
+ * @param count the number of subtrees
+ * @param depth the moves leading to every subtree
+ * @return the subtrees in their new order, or level itself if memory ran out
+ */
+static unsigned char (*orderFrontier(struct solve_job *job, unsigned char (*level)[FRONTIER_MAX_DEPTH], int count, int depth))[FRONTIER_MAX_DEPTH]{
+    struct solver *s = job->root;
+    packed_state *states = malloc(count * sizeof(packed_state));
+    unsigned char *distances = malloc(count);
+    unsigned char (*ordered)[FRONTIER_MAX_DEPTH] = malloc((size_t)count * FRONTIER_MAX_DEPTH);
+    int *next = calloc(job->threads, sizeof(int));
+    if(states == NULL || distances == NULL || ordered == NULL || next == NULL){
+        free(states);
+        free(distances);
+        free(ordered);
+        free(next);
+        return level;
+    }
+    for(int n = 0; n<count;n++){
+        replay(s, level[n], depth);
+        states[n] = packCells(s->board, s->size);
+        unwind(s, job->root_blank, level[n], depth);
+    }
+    packedManhattanBatch(states, count, s->size, distances);
+    for(int w = 0; w<job->threads;w++){
+        next[w] = (long)count * w / job->threads; // the same shares shareWork hands out
+    }
+    int w = 0;
+    for(int distance = 0; distance<256;distance++){ // dealt round the shares, nearest first
+        for(int n = 0; n<count;n++){
+            if(distances[n] != distance) continue;
+            while(next[w] == (long)count * (w+1) / job->threads) w = (w+1) % job->threads; // skip full shares
+            memcpy(ordered[next[w]++], level[n], FRONTIER_MAX_DEPTH);
+            w = (w+1) % job->threads;
+        }
+    }
+    free(states);
+    free(distances);
+    free(next);
+    free(level);
+    return ordered;
+}
+
+/**
+ * Splits the tree into subtrees by expanding it breadth first until there are enough
+ * for every worker, checking each expanded node for a win so no short solution is skipped.
+ * Boards that fit a packed state are deduplicated, since equal boards at the same depth
+ * root equal subtrees.
+ * @param job the job to split the tree for
+ * @return the length of a solution found while expanding, NOT_FOUND otherwise, ABORTED if memory ran out
+ */
+static int expandFrontier(struct solve_job *job){
+    struct solver *s = job->root;
+    int target = job->threads * FRONTIER_PER_THREAD;
+    int capacity = 1;
+    unsigned char (*level)[FRONTIER_MAX_DEPTH] = calloc(capacity, FRONTIER_MAX_DEPTH);
+    if(level == NULL) return ABORTED;
+    int count = 1; // the board itself
+    int depth = 0;
+    while(depth < FRONTIER_MAX_DEPTH){
+        unsigned char (*next)[FRONTIER_MAX_DEPTH] = calloc(count*3 > 0 ? count*3 : 1, FRONTIER_MAX_DEPTH); // at most 3 moves don't undo the last one
+        if(next == NULL){
+            free(level);
+            return ABORTED;
+        }
+        int next_count = 0;
+        uint64_t mask = 0;
+        packed_state *seen = NULL; // children of this level already kept
+        if(s->size <= PACKED_MAX_SIZE){
+            for(mask = 1; mask < (uint64_t)count*6; mask <<= 1); // at most half full
+            seen = calloc(mask, sizeof(packed_state));
+            mask--;
+        }
+        for(int n = 0; n<count;n++){
+            replay(s, level[n], depth);
+            if(s->manhattan == 0){ // won within the expanded levels, breadth first makes it the shortest
+                for(int i = 0; i<depth;i++){
+                    job->moves[i] = s->path[i];
+                }
+                unwind(s, job->root_blank, level[n], depth);
+                free(level);
+                free(next);
+                free(seen);
+                return depth;
+            }
+            if(count >= target) { // this level is wide enough, it only had to be checked for a win
+                unwind(s, job->root_blank, level[n], depth);
+                continue;
+            }
+            int previous = depth >= 2 ? level[n][depth-2] : (depth == 1 ? job->root_blank : -1);
+            int row = s->blank/s->size, column = s->blank%s->size;
+            int neighbours[4];
+            int moves = 0;
+            if(row > 0) neighbours[moves++] = s->blank - s->size;
+            if(row < s->size-1) neighbours[moves++] = s->blank + s->size;
+            if(column > 0) neighbours[moves++] = s->blank - 1;
+            if(column < s->size-1) neighbours[moves++] = s->blank + 1;
+            packed_state parent = seen != NULL ? packCells(s->board, s->size) : 0;
+            for(int m = 0; m<moves;m++){
+                if(neighbours[m] == previous) continue;
+                if(seen != NULL && !addUnique(seen, mask, packedMove(parent, s->blank, neighbours[m])))
+                    continue; // reached by another path of the same length
+                for(int i = 0; i<depth;i++){
+                    next[next_count][i] = level[n][i];
+                }
+                next[next_count++][depth] = neighbours[m];
+            }
+            unwind(s, job->root_blank, level[n], depth);
+        }
+        free(seen);
+        if(count >= target){
+            free(next);
+            break;
+        }
+        free(level);
+        level = next;
+        count = next_count;
+        depth++;
+    }
+    if(s->size <= PACKED_MAX_SIZE && count > 1) level = orderFrontier(job, level, count, depth);
+    job->frontier = level;
+    job->frontier_count = count;
+    job->frontier_depth = depth;
+    return NOT_FOUND;
+}
+
+/**
+ * Takes the next subtree, from the worker's own share first and then from the others
+ * @param job the running job
+ * @param self the index of the worker
+ * @return the subtree to search, or -1 when every share is empty
+ */
+static int takeWork(struct solve_job *job, int self){
+    for(int k = 0; k<job->threads;k++){
+        struct work_range *range = &job->ranges[(self+k) % job->threads];
+        if(atomic_load_explicit(&range->next, memory_order_relaxed) >= range->end) continue;
+        int node = atomic_fetch_add_explicit(&range->next, 1, memory_order_relaxed);
+        if(node < range->end) return node;
+    }
+    return -1;
+}
+
+/**
+ * Splits the subtrees evenly between the workers for the next iteration
+ * @param job the running job
+ */
+static void shareWork(struct solve_job *job){
+    for(int w = 0; w<job->threads;w++){
+        atomic_store(&job->ranges[w].next, (long)job->frontier_count * w / job->threads);
+        job->ranges[w].end = (long)job->frontier_count * (w+1) / job->threads;
+    }
+    atomic_store(&job->next_bound, __INT_MAX__);
+}
+
+/**
+ * Arguments of a worker thread
+ */
+struct worker {
+    struct solve_job *job; // the running job
+    int index; // the index of the worker, 0 is the coordinator
+    struct solver *s; // the worker's own search state
+};
+
+/**
+ * Searches subtrees until the job finishes, one iteration of the bound at a time
+ * @param arg the worker
+ * @return NULL
+ */
+static void *solveWorker(void *arg){
+    struct worker *w = arg;
+    struct solve_job *job = w->job;
+    struct solver *s = w->s;
+    if(w->index > 0){ // waits until the coordinator knows how many workers started
+        pthread_mutex_lock(&job->gate);
+        pthread_mutex_unlock(&job->gate);
+    }
+    int depth = job->frontier_depth;
+    while(1){
+        int node;
+        while(!atomic_load_explicit(&job->stop, memory_order_relaxed) && (node = takeWork(job, w->index)) != -1){
+            const unsigned char *cells = job->frontier[node];
+            replay(s, cells, depth);
+            int previous = depth >= 2 ? cells[depth-2] : (depth == 1 ? job->root_blank : -1);
+            s->next_bound = __INT_MAX__;
+            int result = search(s, depth, job->bound, previous);
+            unwind(s, job->root_blank, cells, depth);
+            int seen = atomic_load(&job->next_bound);
+            while(s->next_bound < seen && !atomic_compare_exchange_weak(&job->next_bound, &seen, s->next_bound)); // share the smallest estimate over the bound
+            if(result >= 0){
+                int none = -1;
+                if(atomic_compare_exchange_strong(&job->found, &none, result)){ // the first solution of an iteration is as short as any other
+                    for(int i = 0; i<result;i++){
+                        job->moves[i] = s->path[i];
+                    }
+                }
+                atomic_store(&job->stop, true);
+            }else if(result == ABORTED){ // out of nodes or moves, a solution another worker found still stands
+                atomic_store(&job->stop, true);
+            }
+        }
+        pthread_barrier_wait(&job->barrier);
+        if(w->index == 0){ // the coordinator decides whether another iteration runs
+            int next_bound = atomic_load(&job->next_bound);
+            job->finished = atomic_load(&job->stop) || next_bound == __INT_MAX__;
+            job->bound = next_bound;
+            shareWork(job);
+        }
+        pthread_barrier_wait(&job->barrier);
+        if(job->finished) break;
+    }
+    return NULL;
+}
+
+/**
+ * Runs a whole job, splitting the tree and then searching it with the worker pool
+ * @param arg the job
+ * @return NULL
+ */
+static void *solveCoordinator(void *arg){
+    struct solve_job *job = arg;
+    job->result = -1;
+    int board[MAX_CELLS];
+    for(int i = 0; i<job->root->cells;i++){
+        board[i] = job->root->board[i];
+    }
+    job->result = recallPath(board, job->root->size, job->root->weight == 1, job->moves, SOLVER_MAX_MOVES);
+    if(job->result >= 0){
+        atomic_store_explicit(&job->done, true, memory_order_release);
+        return NULL;
+    }
+    cacheNewGeneration();
+    int shallow = expandFrontier(job);
+    if(shallow >= 0){
+        job->result = shallow;
+        rememberPath(board, job->root->size, job->moves, job->result, job->root->weight == 1);
+    }
+    if(shallow != NOT_FOUND){
+        atomic_store_explicit(&job->done, true, memory_order_release);
+        return NULL;
+    }
+    struct worker *workers = calloc(job->threads, sizeof(struct worker));
+    pthread_t *threads = calloc(job->threads, sizeof(pthread_t));
+    job->ranges = calloc(job->threads, sizeof(struct work_range));
+    int started = 0;
+    if(workers != NULL && threads != NULL && job->ranges != NULL){
+        atomic_init(&job->budget, SOLVER_BACKGROUND_NODE_LIMIT);
+        for(started = 0; started<job->threads;started++){
+            struct solver *s = malloc(sizeof(struct solver));
+            if(s == NULL) break;
+            *s = *job->root; // each worker searches its own copy of the board
+            s->stop = &job->stop;
+            s->nodes = 0;
+            s->node_limit = 0; // every node comes from the shared budget, so no share of it sits unused
+            s->budget = &job->budget;
+            workers[started].job = job;
+            workers[started].index = started;
+            workers[started].s = s;
+        }
+        pthread_mutex_init(&job->gate, NULL);
+        pthread_mutex_lock(&job->gate);
+        int running = started > 0 ? 1 : 0; // the coordinator is worker 0
+        while(running < started && pthread_create(&threads[running], NULL, solveWorker, &workers[running]) == 0){
+            running++;
+        }
+        if(running > 0){
+            job->threads = running; // the tree is shared between the workers that did start
+            pthread_barrier_init(&job->barrier, NULL, running);
+            job->bound = job->root->weight * heuristic(job->root);
+            shareWork(job);
+            pthread_mutex_unlock(&job->gate);
+            solveWorker(&workers[0]);
+            for(int w = 1; w<running;w++){
+                pthread_join(threads[w], NULL);
+            }
+            if(atomic_load(&job->found) >= 0)
+                job->result = atomic_load(&job->found);
+            pthread_barrier_destroy(&job->barrier);
+        }else{
+            pthread_mutex_unlock(&job->gate);
+        }
+        pthread_mutex_destroy(&job->gate);
+    }
+    for(int w = 0; w<started;w++){
+        free(workers[w].s);
+    }
+    free(workers);
+    free(threads);
+    if(job->result >= 0) rememberPath(board, job->root->size, job->moves, job->result, job->root->weight == 1);
+    atomic_store_explicit(&job->done, true, memory_order_release);
+    return NULL;
+}
+
+/**
+ * Starts solving a board in the background with a pool of worker threads
+ * @param board the tiles of the board, row after row, copied so the game can go on
+ * @param size the size of the square matrix (gameboard)
+ * @param threads the number of workers
+ * @return the running job, or NULL if the board is unsolvable or the job couldn't start
+ */
+struct solve_job *solveStart(const int *board, int size, int threads){
+    if(threads < 1) threads = 1;
+    if(threads > SOLVER_MAX_THREADS) threads = SOLVER_MAX_THREADS;
+    struct solve_job *job = calloc(1, sizeof(struct solve_job));
+    if(job == NULL) return NULL;
+    job->root = prepare(board, size, size == 4 && pdbLoad(size) != NULL ? 1 : solverWeight(size)); // the databases keep 4x4 optimal within the background budget
+    if(job->root == NULL){
+        free(job);
+        return NULL;
+    }
+    job->threads = threads;
+    job->root_blank = job->root->blank;
+    atomic_init(&job->found, -1);
+    if(pthread_create(&job->coordinator, NULL, solveCoordinator, job) != 0){
+        free(job->root);
+        free(job);
+        return NULL;
+    }
+    return job;
+}
+
+/**
+ * Checks on a background job without waiting for it
+ * @param job the job
+ * @param moves filled with the tiles to move once the job is done
+ * @param max_moves the capacity of moves
+ * @return SOLVE_RUNNING while the job runs, then the number of moves, or -1 if no solution was found
+ */
+int solvePoll(struct solve_job *job, int *moves, int max_moves){
+    if(!atomic_load_explicit(&job->done, memory_order_acquire))
+        return SOLVE_RUNNING;
+    if(job->result > max_moves) return -1;
+    for(int i = 0; i<job->result;i++){
+        moves[i] = job->moves[i];
+    }
+    return job->result;
+}
+
+/**
+ * Stops a background job if it still runs and frees it
+ * @param job the job
+ */
+void solveFinish(struct solve_job *job){
+    atomic_store(&job->stop, true);
+    pthread_join(job->coordinator, NULL);
+    free(job->frontier);
+    free(job->ranges);
+    free(job->root);
+    free(job);
+}
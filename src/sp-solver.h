@@ -0,0 +1,26 @@
+#ifndef SP_SOLVER
+#define SP_SOLVER
+
+#include <stdbool.h>
+
+#define SOLVER_MAX_SIZE 10 // largest board the solver accepts
+#define SOLVER_MAX_MOVES 1024 // longest move sequence the solver will search for
+#define SOLVER_MAX_WEIGHT 64 // largest weight solveQuick falls back to
+#define SOLVER_NODE_LIMIT 50000000L // nodes expanded before the solver gives up
+#define SOLVER_BACKGROUND_NODE_LIMIT 4000000000L // nodes all workers of a background job expand before giving up
+#define SOLVER_NODE_CHUNK 65536L // nodes a worker takes from the shared budget at a time
+#define SOLVER_MAX_THREADS 256 // most workers a background job runs
+#define SOLVE_RUNNING -2 // solvePoll result while the job is still searching
+
+struct solve_job;
+
+bool isSolvable(const int *board, int size);
+int solverWeight(int size);
+int solve(const int *board, int size, int weight, int *moves, int max_moves);
+int solveQuick(const int *board, int size, int *moves, int max_moves);
+int hint(const int *board, int size);
+struct solve_job *solveStart(const int *board, int size, int threads);
+int solvePoll(struct solve_job *job, int *moves, int max_moves);
+void solveFinish(struct solve_job *job);
+
+#endif
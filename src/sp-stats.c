@@ -0,0 +1,137 @@
+/**
+ * A @code sp-stats counts the requests the server handles and keeps a histogram of how
+ * long each command takes. Buckets are a quarter of a power of two wide, so recording
+ * a request is a clock read, a count of leading zeros and a few increments. Only the
+ * thread that handles requests records, so nothing is locked.
+ *
+ * @author Adam Khoukhi
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp-stats.h"
+#include "sp-cache.h"
+
+bool stats_tsc = false;
+static struct stats_histogram histograms[STATS_COMMANDS];
+static uint64_t start_ticks; // clock when the counters started, to convert ticks to nanoseconds
+static struct timespec start_time;
+
+static const char *command_names[STATS_COMMANDS] = {
+    "new", "move", "load", "save", "won", "retrieve", "solve", "hint",
+    "solve_start", "solve_poll", "open", "close", "checkpoint", "move_batch", "stats", "undo", "redo", "sync", "other"
+};
+
+/**
+ * Starts the counters and picks the clock
+ */
+void statsInit(){
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    __asm__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000000u));
+    if(eax >= 0x80000007u){
+        __asm__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000007u));
+        stats_tsc = (edx >> 8) & 1; // invariant counter, same rate in every power state
+    }
+#endif
+    memset(histograms, 0, sizeof(histograms));
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    start_ticks = statsClock();
+}
+
+/**
+ * Records how long a request took
+ * @param command the type of request
+ * @param start the clock when the request arrived
+ */
+void statsRecord(int command, uint64_t start){
+    uint64_t ticks = statsClock() - start;
+    if(command < 0 || command >= STATS_COMMANDS) command = STATS_COMMANDS-1;
+    struct stats_histogram *h = &histograms[command];
+    int bucket = 0;
+    if(ticks >= (1u << STATS_SUB_BITS)){ // the top bit picks the power of two and the bits after it the quarter
+        int top = 63 - __builtin_clzll(ticks);
+        bucket = ((top - STATS_SUB_BITS + 1) << STATS_SUB_BITS) | ((ticks >> (top - STATS_SUB_BITS)) & ((1u << STATS_SUB_BITS) - 1));
+    }else{
+        bucket = ticks;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->total += ticks;
+    if(ticks > h->max) h->max = ticks;
+}
+
+/**
+ * Finds the largest number of ticks that falls in a bucket
+ * @param bucket the bucket
+ * @return the upper bound of the bucket
+ */
+static uint64_t bucketLimit(int bucket){
+    if(bucket < (1 << STATS_SUB_BITS)) return bucket;
+    int top = (bucket >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+    uint64_t quarter = bucket & ((1u << STATS_SUB_BITS) - 1);
+    return (((((uint64_t)1 << STATS_SUB_BITS) | quarter) + 1) << (top - STATS_SUB_BITS)) - 1;
+}
+
+/**
+ * Finds the latency a share of the requests stayed under, by the nearest rank
+ * @param h the histogram
+ * @param share the share, 0.99 for the 99th percentile
+ * @return the upper bound of the bucket holding it, in ticks
+ */
+static uint64_t percentile(const struct stats_histogram *h, double share){
+    uint64_t wanted = h->count * share;
+    if(wanted < h->count * share || wanted == 0) wanted++; // the nearest rank, ceil(count*share) and at least the first request
+    uint64_t seen = 0;
+    for(int bucket = 0; bucket<STATS_BUCKETS;bucket++){
+        seen += h->buckets[bucket];
+        if(seen >= wanted) return bucketLimit(bucket) < h->max ? bucketLimit(bucket) : h->max;
+    }
+    return h->max;
+}
+
+/**
+ * Writes the counters as a table, one line per command that was used, then the cache counters
+ * @param text filled with the table
+ * @param capacity the size of text
+ * @return the length of the table
+ */
+size_t statsFormat(char *text, size_t capacity){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - start_time.tv_sec) * 1e9 + (now.tv_nsec - start_time.tv_nsec);
+    double per_tick = 1.0; // nanoseconds per tick
+    if(stats_tsc && statsClock() > start_ticks && elapsed > 0)
+        per_tick = elapsed / (statsClock() - start_ticks);
+    size_t length = 0;
+    length += snprintf(text + length, capacity - length, "%-12s %10s %10s %10s %10s %10s\n", "command", "count", "mean_ns", "p50_ns", "p99_ns", "max_ns");
+    for(int command = 0; command<STATS_COMMANDS && length < capacity;command++){
+        const struct stats_histogram *h = &histograms[command];
+        if(h->count == 0) continue;
+        length += snprintf(text + length, capacity - length, "%-12s %10llu %10.0f %10.0f %10.0f %10.0f\n", command_names[command],
+            (unsigned long long)h->count, h->total * per_tick / h->count, percentile(h, 0.5) * per_tick, percentile(h, 0.99) * per_tick, h->max * per_tick);
+    }
+    struct cache_stats cache;
+    cacheGetStats(&cache);
+    if(length < capacity)
+        length += snprintf(text + length, capacity - length, "cache        hits %lu misses %lu stores %lu replacements %lu entries %zu\n",
+            cache.hits, cache.misses, cache.stores, cache.replacements, cache.entries);
+    return length < capacity ? length : capacity - 1;
+}
+
+/**
+ * Writes the counters to the file named by SP_STATS_FILE, or STATS_FILE
+ * @return true if the file was written
+ */
+bool statsDump(){
+    const char *filename = getenv("SP_STATS_FILE");
+    if(filename == NULL) filename = STATS_FILE;
+    FILE *fp = fopen(filename, "w");
+    if(fp == NULL) return false;
+    char text[4096];
+    size_t length = statsFormat(text, sizeof(text));
+    bool written = fwrite(text, 1, length, fp) == length;
+    return fclose(fp) == 0 && written;
+}
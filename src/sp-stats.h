@@ -0,0 +1,47 @@
+#ifndef SP_STATS
+#define SP_STATS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define STATS_COMMANDS 19 // commands that get a histogram, higher ones share the last
+#define STATS_SUB_BITS 2 // each power of two is split in 4 buckets
+#define STATS_BUCKETS (64 << STATS_SUB_BITS)
+#define STATS_FILE "sp-stats.txt" // where the counters go at teardown unless SP_STATS_FILE names another file
+
+/**
+ * Latencies of one command, in clock ticks
+ */
+struct stats_histogram {
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t buckets[STATS_BUCKETS];
+};
+
+extern bool stats_tsc; // whether statsClock reads the time stamp counter
+
+/**
+ * Reads the clock the latencies are measured with, the time stamp counter when it ticks at a constant rate
+ * @return the time in ticks
+ */
+static inline uint64_t statsClock(){
+#if defined(__x86_64__) || defined(__i386__)
+    if(stats_tsc) return __rdtsc();
+#endif
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+void statsInit();
+void statsRecord(int command, uint64_t start);
+size_t statsFormat(char *text, size_t capacity);
+bool statsDump();
+
+#endif